@@ -1,116 +1,1328 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <stdatomic.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <tmmintrin.h>
+#define SSSE3_KERNELS // compiled for SSSE3 whatever -march says, used if the CPU has it
+#endif
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #define MAX_STR_LEN 64
+#define SMALL_BUFFER_SIZE 64 // bytes kept inside the Vector itself
+#define MMAP_THRESHOLD (1 << 20) // bytes above which storage is mmapped
+#define VOWELS "aeiouyAEIOUY"
+#define FILE_MAGIC 0x54434556u // "VECT"
+#define FILE_HEADER_SIZE 64 // elements start this many bytes into the file
+#define ARENA_BLOCK_SIZE (64 * 1024) // default size of an arena block
+#define MAX_THREADS 64
+#define PARALLEL_MIN_ELEMENTS 65536 // smaller vectors are filtered by one thread
+#define PACK_BLOCK 128 // ints per block of a PackedInts
+#define COW_CHUNK 256 // elements per chunk of a CowVector
 
+// how capacity grows when push_back or insert run out of room
+typedef enum GrowthPolicy {
+    GROW_DOUBLE, // capacity * 2
+    GROW_HALF, // capacity * 1.5
+    GROW_CHUNK // capacity + growth_chunk
+} GrowthPolicy;
+
+// where the elements currently live
+typedef enum Storage {
+    STORAGE_SMALL, // small_buffer inside the Vector
+    STORAGE_HEAP, // block from the vector's allocator
+    STORAGE_MAPPED, // anonymous mapping, grown with mremap without copying
+    STORAGE_FILE // shared mapping of a file, grown with ftruncate + mremap
+} Storage;
+
+typedef int(* cmp_ptr)(const void*, const void*);
+
+// source of STORAGE_HEAP blocks
+typedef struct Allocator {
+    // Resize block ptr (NULL for a new block) from old_size to new_size bytes
+    // keeping its contents; returns NULL on failure, ptr is then still valid
+    void* (* reallocate)(void* context, void* ptr, size_t old_size, size_t new_size);
+    // Give back block ptr of size bytes
+    void (* release)(void* context, void* ptr, size_t size);
+    void* context;
+} Allocator;
+
+// data may point into the Vector itself (small_buffer),
+// so a Vector must not be copied by value
 typedef struct Vector {
     void* data;
     size_t element_size;
     size_t size;
     size_t capacity;
+    Storage storage;
+    size_t mapped_bytes; // length of the mapping (for STORAGE_FILE: of the file)
+    int fd; // open file of STORAGE_FILE, -1 otherwise
+    GrowthPolicy growth;
+    size_t growth_chunk;
+    Allocator allocator;
+    cmp_ptr sorted_by; // comparator the elements are known to be sorted by, or NULL
+    int gap_mode; // insert and erase move a gap instead of the tail
+    int gap_open; // the gap (capacity - size slots at gap_start) is not at the end
+    size_t gap_start;
+    union {
+        max_align_t align;
+        unsigned char bytes[SMALL_BUFFER_SIZE];
+    } small_buffer;
 } Vector;
 
+// start of a file holding a persistent Vector,
+// followed by the elements at FILE_HEADER_SIZE
+typedef struct FileHeader {
+    uint32_t magic;
+    uint32_t element_size;
+    uint64_t size;
+} FileHeader;
+
+// chunk of memory handed out by an Arena
+typedef struct ArenaBlock {
+    struct ArenaBlock* next;
+    size_t size; // bytes in data
+    size_t used; // bytes handed out
+    size_t last; // offset of the most recent allocation
+    max_align_t data[];
+} ArenaBlock;
+
+// bump allocator: everything it handed out is freed at once by free_arena()
+typedef struct Arena {
+    ArenaBlock* blocks; // current block first
+    size_t block_size;
+} Arena;
+
+// PACK_BLOCK values stored as value - reference in width bits each.
+// Value j goes to lane j % 4, slot j / 4: the 4 lanes are interleaved word
+// by word so that one 128-bit load holds the same word of every lane
+typedef struct PackedBlock {
+    int reference; // smallest value of the block
+    unsigned width; // bits per value, 0..32
+    size_t offset; // first word of the block (4 * width words)
+} PackedBlock;
+
+// read-only compressed copy of an int vector (frame of reference + bit packing);
+// sorted or slowly varying vectors need only a few bits per value
+typedef struct PackedInts {
+    size_t size;
+    PackedBlock* blocks;
+    uint32_t* words;
+} PackedInts;
+
+// COW_CHUNK elements, shared by every CowTable that references them
+typedef struct CowChunk {
+    atomic_size_t references;
+    max_align_t data[];
+} CowChunk;
+
+// one version of a CowVector's contents; never changed while shared
+typedef struct CowTable {
+    atomic_size_t references;
+    size_t element_size;
+    size_t size;
+    size_t chunk_count;
+    size_t chunk_capacity;
+    CowChunk* chunks[];
+} CowTable;
+
+// vector that hands out O(1) read-only snapshots (CowTable pointers).
+// Writes copy only the table and the chunks still shared with a snapshot,
+// so readers of a snapshot never lock and never see a write in progress.
+// All CowVector functions must be called by a single writer thread;
+// snapshots may be read and released from any thread
+typedef struct CowVector {
+    CowTable* table;
+} CowVector;
+
 typedef struct Person {
     int age;
     char first_name[MAX_STR_LEN];
     char last_name[MAX_STR_LEN];
 } Person;
 
-typedef int(* cmp_ptr)(const void*, const void*);
-
 typedef int(* predicate_ptr)(void*);
 
 typedef void(* read_ptr)(void*);
 
 typedef void(* print_ptr)(const void*);
 
-// Allocate vector to initial capacity (block_size elements),
-// Set element_size, size (to 0), capacity
-void init_vector(Vector* vector, size_t block_size, size_t element_size) {
-    vector->element_size = element_size;
-    vector->size = 0;
-    vector->capacity = block_size;
-    vector->data = malloc(vector->capacity * element_size);
+// built-in int filters run by filter_ints()
+typedef enum IntFilter {
+    INT_EVEN, // remove even values
+    INT_ODD, // remove odd values
+    INT_RANGE // remove values in [low, high]
+} IntFilter;
+
+int is_even(void* value);
+
+int is_odd(void* value);
+
+int is_vowel(void* value);
+
+void* heap_reallocate(void* context, void* ptr, size_t old_size, size_t new_size) {
+    (void) context;
+    (void) old_size;
+    return realloc(ptr, new_size);
+}
+
+void heap_release(void* context, void* ptr, size_t size) {
+    (void) context;
+    (void) size;
+    free(ptr);
+}
+
+// default allocator: malloc/realloc/free
+const Allocator heap_allocator = {heap_reallocate, heap_release, NULL};
+
+// block_size 0 selects ARENA_BLOCK_SIZE
+void init_arena(Arena* arena, size_t block_size) {
+    arena->blocks = NULL;
+    arena->block_size = block_size ? block_size : ARENA_BLOCK_SIZE;
+}
+
+// Free every block of the arena, and so the storage of every vector using it
+void free_arena(Arena* arena) {
+    ArenaBlock* next;
+    for (ArenaBlock* block = arena->blocks; block != NULL; block = next) {
+        next = block->next;
+        free(block);
+    }
+    arena->blocks = NULL;
+}
+
+// The most recent allocation is resized in place while it fits its block,
+// anything else gets a fresh bump allocation (the old bytes are only
+// reclaimed by free_arena)
+void* arena_reallocate(void* context, void* ptr, size_t old_size, size_t new_size) {
+    Arena* arena = context;
+    ArenaBlock* block = arena->blocks;
+    size_t align = sizeof(max_align_t);
+    size_t rounded = (new_size + align - 1) / align * align;
+    if (block != NULL && ptr == (char*) block->data + block->last && block->last + rounded <= block->size) {
+        block->used = block->last + rounded;
+        return ptr;
+    }
+    if (block == NULL || block->used + rounded > block->size) {
+        size_t size = rounded > arena->block_size ? rounded : arena->block_size;
+        block = malloc(sizeof(ArenaBlock) + size);
+        if (block == NULL) return NULL;
+        block->next = arena->blocks;
+        block->size = size;
+        block->used = 0;
+        arena->blocks = block;
+    }
+    char* data = (char*) block->data + block->used;
+    block->last = block->used;
+    block->used += rounded;
+    if (ptr != NULL)
+        memcpy(data, ptr, old_size < new_size ? old_size : new_size);
+    return data;
+}
+
+// Only the most recent allocation can be given back early
+void arena_release(void* context, void* ptr, size_t size) {
+    Arena* arena = context;
+    ArenaBlock* block = arena->blocks;
+    (void) size;
+    if (block != NULL && ptr == (char*) block->data + block->last)
+        block->used = block->last;
+}
+
+// Allocator handing out memory from arena
+Allocator arena_allocator(Arena* arena) {
+    Allocator allocator = {arena_reallocate, arena_release, arena};
+    return allocator;
+}
+
+// --- gap buffer: in gap mode the free capacity is kept as a gap that
+// follows the last insertion or erasure, so runs of nearby inserts and
+// erases only move the elements between consecutive positions
+
+// Address of element index, taking the gap into account
+void* element_at(const Vector* vector, size_t index) {
+    if (vector->gap_open && index >= vector->gap_start)
+        index += vector->capacity - vector->size;
+    return ((char*) (vector->data)) + (vector->element_size * index);
+}
+
+// Move the gap so that it starts at index (0 <= index <= size)
+void move_gap(Vector* vector, size_t index) {
+    size_t es = vector->element_size;
+    size_t gap = vector->capacity - vector->size;
+    char* data = vector->data;
+    if (!vector->gap_open) vector->gap_start = vector->size;
+    if (index < vector->gap_start)
+        memmove(data + es * (index + gap), data + es * index, es * (vector->gap_start - index));
+    else if (index > vector->gap_start)
+        memmove(data + es * vector->gap_start, data + es * (vector->gap_start + gap), es * (index - vector->gap_start));
+    vector->gap_start = index;
+    vector->gap_open = index != vector->size;
+}
+
+// Make the elements contiguous again (gap at the end)
+void close_gap(Vector* vector) {
+    if (vector->gap_open) move_gap(vector, vector->size);
+}
+
+// Turn gap mode on or off; turning it off closes the gap
+void set_gap_mode(Vector* vector, int enabled) {
+    if (!enabled) close_gap(vector);
+    vector->gap_mode = enabled;
+}
+
+// header of a STORAGE_FILE vector
+FileHeader* file_header(const Vector* vector) {
+    return (FileHeader*) ((char*) (vector->data) - FILE_HEADER_SIZE);
+}
+
+// Record the size of a file-backed vector in its header and schedule the
+// dirty pages for writing. Does nothing for other storage.
+// Returns 0 on success, -1 on error
+int sync_vector(Vector* vector) {
+    if (vector->storage != STORAGE_FILE) return 0;
+    close_gap(vector);
+    file_header(vector)->size = vector->size;
+    return msync(file_header(vector), vector->mapped_bytes, MS_ASYNC);
+}
+
+// Give back the current storage and point data at the small buffer
+void release_storage(Vector* vector) {
+    if (vector->storage == STORAGE_HEAP)
+        vector->allocator.release(vector->allocator.context, vector->data, vector->capacity * vector->element_size);
+    else if (vector->storage == STORAGE_MAPPED)
+        munmap(vector->data, vector->mapped_bytes);
+    else if (vector->storage == STORAGE_FILE) {
+        sync_vector(vector);
+        munmap(file_header(vector), vector->mapped_bytes);
+        close(vector->fd);
+        vector->fd = -1;
+    }
+    vector->storage = STORAGE_SMALL;
+    vector->data = vector->small_buffer.bytes;
+    vector->mapped_bytes = 0;
+}
+
+// Resize the file of a file-backed vector to hold bytes bytes of elements
+// and remap it. Returns 0 on success, -1 on error
+int resize_file(Vector* vector, size_t bytes) {
+    size_t file_bytes = FILE_HEADER_SIZE + bytes;
+    if (file_bytes > vector->mapped_bytes && ftruncate(vector->fd, (off_t) file_bytes)) return -1;
+    void* base = mremap(file_header(vector), vector->mapped_bytes, file_bytes, MREMAP_MAYMOVE);
+    if (base == MAP_FAILED) return -1;
+    if (file_bytes < vector->mapped_bytes && ftruncate(vector->fd, (off_t) file_bytes)) return -1;
+    vector->data = (char*) base + FILE_HEADER_SIZE;
+    vector->mapped_bytes = file_bytes;
+    return 0;
+}
+
+// Move the elements to storage able to hold bytes bytes.
+// Small blocks go inline, big ones to an anonymous mapping resized with mremap
+// (default allocator only), the rest to the vector's allocator. Returns 0 on success, -1 if memory could not be obtained
+// (the vector is then left unchanged).
+int move_storage(Vector* vector, size_t bytes) {
+    size_t used = vector->size * vector->element_size;
+    void* data;
+    close_gap(vector);
+    if (vector->storage == STORAGE_FILE)
+        return resize_file(vector, bytes);
+    if (bytes <= SMALL_BUFFER_SIZE) {
+        if (vector->storage != STORAGE_SMALL) {
+            memcpy(vector->small_buffer.bytes, vector->data, used);
+            release_storage(vector);
+        }
+        return 0;
+    }
+    if (bytes >= MMAP_THRESHOLD && vector->allocator.reallocate == heap_reallocate) {
+        size_t page = (size_t) sysconf(_SC_PAGESIZE);
+        size_t mapped_bytes = (bytes + page - 1) / page * page;
+        if (vector->storage == STORAGE_MAPPED) {
+            data = mremap(vector->data, vector->mapped_bytes, mapped_bytes, MREMAP_MAYMOVE);
+            if (data == MAP_FAILED) return -1;
+        } else {
+            data = mmap(NULL, mapped_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (data == MAP_FAILED) return -1;
+            memcpy(data, vector->data, used);
+            release_storage(vector);
+        }
+        vector->data = data;
+        vector->storage = STORAGE_MAPPED;
+        vector->mapped_bytes = mapped_bytes;
+        return 0;
+    }
+    Allocator* allocator = &vector->allocator;
+    if (vector->storage == STORAGE_HEAP) {
+        data = allocator->reallocate(allocator->context, vector->data, vector->capacity * vector->element_size, bytes);
+        if (data == NULL) return -1;
+    } else {
+        data = allocator->reallocate(allocator->context, NULL, 0, bytes);
+        if (data == NULL) return -1;
+        memcpy(data, vector->data, used);
+        release_storage(vector);
+    }
+    vector->data = data;
+    vector->storage = STORAGE_HEAP;
+    return 0;
 }
 
 // If new_capacity is greater than the current capacity,
 // new storage is allocated, otherwise the function does nothing.
-void reserve(Vector* vector, size_t new_capacity) {
-    if (new_capacity > vector->capacity) {
-        vector->data = realloc(vector->data, new_capacity * vector->element_size);
-        vector->capacity = new_capacity;
+// Returns 0 on success, -1 if the memory could not be allocated
+int reserve(Vector* vector, size_t new_capacity) {
+    if (new_capacity <= vector->capacity) return 0;
+    if (new_capacity > SIZE_MAX / vector->element_size) return -1;
+    if (move_storage(vector, new_capacity * vector->element_size)) return -1;
+    vector->capacity = new_capacity;
+    return 0;
+}
+
+// Allocate vector to initial capacity (block_size elements) from allocator,
+// Set element_size, size (to 0), capacity.
+// Growth policy defaults to doubling; block_size is also used as the
+// chunk for GROW_CHUNK. Returns 0 on success, -1 on allocation failure
+int init_vector_with_allocator(Vector* vector, size_t block_size, size_t element_size, Allocator allocator) {
+    vector->element_size = element_size;
+    vector->size = 0;
+    vector->capacity = 0;
+    vector->storage = STORAGE_SMALL;
+    vector->data = vector->small_buffer.bytes;
+    vector->mapped_bytes = 0;
+    vector->fd = -1;
+    vector->growth = GROW_DOUBLE;
+    vector->growth_chunk = block_size;
+    vector->allocator = allocator;
+    vector->sorted_by = NULL;
+    vector->gap_mode = 0;
+    vector->gap_open = 0;
+    vector->gap_start = 0;
+    return reserve(vector, block_size);
+}
+
+// init_vector_with_allocator() using malloc
+int init_vector(Vector* vector, size_t block_size, size_t element_size) {
+    return init_vector_with_allocator(vector, block_size, element_size, heap_allocator);
+}
+
+// Open a vector whose elements live in the file at path.
+// An existing file is mapped as is (no element is read or copied);
+// otherwise the file is created with capacity for block_size elements.
+// The size is stored in the file by sync_vector() and free_vector().
+// Returns 0 on success, -1 on error (including an element_size mismatch)
+int open_vector_file(Vector* vector, const char* path, size_t block_size, size_t element_size) {
+    if (init_vector(vector, 0, element_size)) return -1;
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return -1;
+    struct stat st;
+    size_t file_bytes = FILE_HEADER_SIZE + block_size * element_size;
+    int created = 0;
+    if (fstat(fd, &st)) goto error;
+    if (st.st_size == 0) {
+        if (ftruncate(fd, (off_t) file_bytes)) goto error;
+        created = 1;
+    } else if ((size_t) st.st_size < FILE_HEADER_SIZE) goto error;
+    else file_bytes = (size_t) st.st_size;
+    void* base = mmap(NULL, file_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) goto error;
+    FileHeader* header = base;
+    if (created) {
+        header->magic = FILE_MAGIC;
+        header->element_size = (uint32_t) element_size;
+        header->size = 0;
+    } else if (header->magic != FILE_MAGIC || header->element_size != element_size ||
+               header->size > (file_bytes - FILE_HEADER_SIZE) / element_size) {
+        munmap(base, file_bytes);
+        goto error;
     }
+    vector->storage = STORAGE_FILE;
+    vector->data = (char*) base + FILE_HEADER_SIZE;
+    vector->mapped_bytes = file_bytes;
+    vector->fd = fd;
+    vector->size = header->size;
+    vector->capacity = (file_bytes - FILE_HEADER_SIZE) / element_size;
+    return 0;
+error:
+    close(fd);
+    return -1;
+}
+
+// Set the growth policy; chunk is used only by GROW_CHUNK
+void set_growth_policy(Vector* vector, GrowthPolicy growth, size_t chunk) {
+    vector->growth = growth;
+    vector->growth_chunk = chunk;
+}
+
+// Capacity to grow to when at least min_capacity elements must fit
+size_t grown_capacity(const Vector* vector, size_t min_capacity) {
+    size_t capacity = vector->capacity;
+    switch (vector->growth) {
+        case GROW_HALF:
+            capacity += capacity / 2;
+            break;
+        case GROW_CHUNK:
+            capacity += vector->growth_chunk;
+            break;
+        default:
+            capacity *= 2;
+            break;
+    }
+    return capacity < min_capacity ? min_capacity : capacity;
+}
+
+// Free the storage of the vector
+void free_vector(Vector* vector) {
+    release_storage(vector);
+    vector->gap_open = 0;
+    vector->size = 0;
+    vector->capacity = 0;
 }
 
 // Resizes the vector to contain new_size elements.
 // If the current size is greater than new_size, the container is
 // reduced to its first new_size elements.
 // If the current size is less than new_size,
-// additional zero-initialized elements are appended
-void resize(Vector* vector, size_t new_size) {
-    if (new_size > vector->size)
+// additional zero-initialized elements are appended.
+// Returns 0 on success, -1 on allocation failure
+int resize(Vector* vector, size_t new_size) {
+    if (reserve(vector, new_size)) return -1;
+    close_gap(vector);
+    if (new_size > vector->size) {
         memset(((char*) (vector->data)) + (vector->size * vector->element_size), 0, (new_size - vector->size) * vector->element_size);
+        vector->sorted_by = NULL;
+    }
     vector->size = new_size;
+    return 0;
+}
+
+// Make room for count elements at index (0 <= index <= size),
+// shifting the tail once (in gap mode: moving the gap there).
+// The new slots are left uninitialized.
+// Returns a pointer to the first of them, NULL on allocation failure
+void* emplace_range(Vector* vector, size_t index, size_t count) {
+    if (vector->size + count > vector->capacity && reserve(vector, grown_capacity(vector, vector->size + count)))
+        return NULL;
+    vector->sorted_by = NULL;
+    if (vector->gap_mode) {
+        move_gap(vector, index);
+        vector->gap_start += count;
+        vector->size += count;
+        vector->gap_open = vector->gap_start != vector->size;
+        return element_at(vector, index);
+    }
+    char* position = ((char*) (vector->data)) + (vector->element_size * index);
+    memmove(position + count * vector->element_size, position, (vector->size - index) * vector->element_size);
+    vector->size += count;
+    return position;
+}
+
+// Make room for one element at index, see emplace_range()
+void* emplace(Vector* vector, size_t index) {
+    return emplace_range(vector, index, 1);
+}
+
+// Make room for one element at the end, see emplace_range()
+void* emplace_back(Vector* vector) {
+    return emplace_range(vector, vector->size, 1);
 }
 
-// Add element to the end of the vector
-void push_back(Vector* vector, void* value) {
-    vector->size += 1;
-    if (vector->size > vector->capacity)
-        reserve(vector, vector->capacity * 2);
-    memcpy(((char*) (vector->data)) + (vector->element_size * (vector->size - 1)), value, vector->element_size);
+// Add element to the end of the vector.
+// Returns 0 on success, -1 on allocation failure
+int push_back(Vector* vector, void* value) {
+    void* position = emplace_back(vector);
+    if (position == NULL) return -1;
+    memcpy(position, value, vector->element_size);
+    return 0;
 }
 
 // Remove all elements from the vector
 void clear(Vector* vector) {
     vector->size = 0;
+    vector->gap_open = 0;
 }
 
-// Insert new element at index (0 <= index <= size) position
-void insert(Vector* vector, size_t index, void* value) {
-    vector->size += 1;
-    if (vector->size > vector->capacity)
-        reserve(vector, vector->capacity * 2);
-    char* position = ((char*) (vector->data)) + (vector->element_size * index);
-    memmove(position + vector->element_size, position, (vector->size - 1 - index) * vector->element_size);
+// Insert new element at index (0 <= index <= size) position.
+// Returns 0 on success, -1 on allocation failure
+int insert(Vector* vector, size_t index, void* value) {
+    void* position = emplace(vector, index);
+    if (position == NULL) return -1;
     memcpy(position, value, vector->element_size);
+    return 0;
+}
+
+// Insert count elements from values at index (0 <= index <= size),
+// reserving and shifting the tail only once.
+// values must not point into the vector.
+// Returns 0 on success, -1 on allocation failure
+int insert_range(Vector* vector, size_t index, const void* values, size_t count) {
+    void* position = emplace_range(vector, index, count);
+    if (position == NULL) return -1;
+    memcpy(position, values, count * vector->element_size);
+    return 0;
+}
+
+// Append count elements from values, see insert_range()
+int append_range(Vector* vector, const void* values, size_t count) {
+    return insert_range(vector, vector->size, values, count);
+}
+
+// Erase elements [first, last) with a single move of the tail
+// (in gap mode: by moving the gap to first and widening it)
+void erase_range(Vector* vector, size_t first, size_t last) {
+    if (vector->gap_mode) {
+        move_gap(vector, first);
+        vector->size -= last - first;
+        vector->gap_open = vector->gap_start != vector->size;
+        return;
+    }
+    char* position = ((char*) (vector->data)) + (vector->element_size * first);
+    memmove(position, position + (last - first) * vector->element_size, (vector->size - last) * vector->element_size);
+    vector->size -= last - first;
 }
 
 // Erase element at position index
 void erase(Vector* vector, size_t index) {
-    char* position = ((char*) (vector->data)) + (vector->element_size * index);
-    memmove(position, position + vector->element_size, (vector->size - index) * vector->element_size);
-    vector->size -= 1;
+    erase_range(vector, index, index + 1);
 }
 
-// Erase all elements that compare equal to value from the container
+// --- sorted vectors: the elements must be sorted by cmp
+
+// Index of the first element not less than value (size if there is none)
+size_t lower_bound(const Vector* vector, const void* value, cmp_ptr cmp) {
+    size_t low = 0, high = vector->size;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (cmp(element_at(vector, middle), value) < 0)
+            low = middle + 1;
+        else high = middle;
+    }
+    return low;
+}
+
+// Index of the first element greater than value (size if there is none)
+size_t upper_bound(const Vector* vector, const void* value, cmp_ptr cmp) {
+    size_t low = 0, high = vector->size;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (cmp(element_at(vector, middle), value) <= 0)
+            low = middle + 1;
+        else high = middle;
+    }
+    return low;
+}
+
+// Set [*first, *last) to the elements equal to value
+void equal_range(const Vector* vector, const void* value, cmp_ptr cmp, size_t* first, size_t* last) {
+    *first = lower_bound(vector, value, cmp);
+    *last = upper_bound(vector, value, cmp);
+}
+
+// Erase all elements that compare equal to value from the container.
+// O(log n + k) if the vector is known to be sorted by cmp, one linear pass otherwise
 void erase_value(Vector* vector, void* value, cmp_ptr cmp) {
-    char* position = ((char*) (vector->data));
-    for (size_t idx = 0; idx < vector->size;) {
-        if (!cmp(position, value))
-            erase(vector, idx);
-        else {
-            position += vector->element_size;
-            idx++;
-        }
+    if (vector->sorted_by == cmp) {
+        size_t first, last;
+        equal_range(vector, value, cmp, &first, &last);
+        erase_range(vector, first, last);
+        return;
+    }
+    close_gap(vector);
+    char* data = vector->data;
+    size_t kept = 0;
+    for (size_t idx = 0; idx < vector->size; idx++) {
+        char* position = data + (vector->element_size * idx);
+        if (!cmp(position, value)) continue;
+        if (kept != idx)
+            memcpy(data + (vector->element_size * kept), position, vector->element_size);
+        kept++;
+    }
+    vector->size = kept;
+}
+
+int keep_int(int value, IntFilter filter, int low, int high) {
+    switch (filter) {
+        case INT_EVEN:
+            return value & 1;
+        case INT_ODD:
+            return !(value & 1);
+        default:
+            return value < low || value > high;
     }
 }
 
-// Erase all elements that satisfy the predicate from the vector
+#ifdef SSSE3_KERNELS
+// pshufb masks moving the kept lanes to the front:
+// int_shuffle for 4 ints, byte_shuffle for 8 chars (indexed by the keep bitmask)
+unsigned char int_shuffle[16][16];
+unsigned char byte_shuffle[256][8];
+
+void init_shuffle_tables(void) {
+    static int ready = 0;
+    if (ready) return;
+    for (int mask = 0; mask < 16; mask++) {
+        int out = 0;
+        memset(int_shuffle[mask], 0x80, 16);
+        for (int lane = 0; lane < 4; lane++)
+            if (mask & (1 << lane)) {
+                for (int byte = 0; byte < 4; byte++)
+                    int_shuffle[mask][out * 4 + byte] = (unsigned char) (lane * 4 + byte);
+                out++;
+            }
+    }
+    for (int mask = 0; mask < 256; mask++) {
+        int out = 0;
+        memset(byte_shuffle[mask], 0x80, 8);
+        for (int lane = 0; lane < 8; lane++)
+            if (mask & (1 << lane))
+                byte_shuffle[mask][out++] = (unsigned char) lane;
+    }
+    ready = 1;
+}
+
+// 1 if the CPU runs the SSSE3 kernels (checked once)
+int has_ssse3(void) {
+    static int supported = -1;
+    if (supported < 0) {
+        __builtin_cpu_init();
+        supported = __builtin_cpu_supports("ssse3") ? 1 : 0;
+        if (supported) init_shuffle_tables();
+    }
+    return supported;
+}
+
+// filter_ints() on the first n / 4 * 4 values, 4 at a time.
+// Returns the number of values kept
+__attribute__((target("ssse3")))
+size_t filter_ints_ssse3(int* data, size_t n, IntFilter filter, int low, int high) {
+    size_t kept = 0;
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i lo = _mm_set1_epi32(low);
+    const __m128i hi = _mm_set1_epi32(high);
+    for (size_t i = 0; i + 4 <= n; i += 4) {
+        __m128i values = _mm_loadu_si128((const __m128i*) (data + i));
+        __m128i keep;
+        if (filter == INT_RANGE)
+            keep = _mm_or_si128(_mm_cmplt_epi32(values, lo), _mm_cmpgt_epi32(values, hi));
+        else
+            keep = _mm_cmpeq_epi32(_mm_and_si128(values, one), filter == INT_EVEN ? one : zero);
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(keep));
+        __m128i shuffle = _mm_loadu_si128((const __m128i*) int_shuffle[mask]);
+        // writes at most up to data + i + 4, which was already loaded
+        _mm_storeu_si128((__m128i*) (data + kept), _mm_shuffle_epi8(values, shuffle));
+        kept += (size_t) __builtin_popcount(mask);
+    }
+    return kept;
+}
+
+// filter_chars() on the first n / 16 * 16 chars, 16 at a time.
+// Returns the number of chars kept
+__attribute__((target("ssse3")))
+size_t filter_chars_ssse3(char* data, size_t n, const char* set, size_t set_len) {
+    size_t kept = 0;
+    const __m128i eight = _mm_set1_epi8(8);
+    for (size_t i = 0; i + 16 <= n; i += 16) {
+        __m128i chars = _mm_loadu_si128((const __m128i*) (data + i));
+        __m128i hit = _mm_setzero_si128();
+        for (size_t k = 0; k < set_len; k++)
+            hit = _mm_or_si128(hit, _mm_cmpeq_epi8(chars, _mm_set1_epi8(set[k])));
+        unsigned keep = ~(unsigned) _mm_movemask_epi8(hit) & 0xFFFF;
+        unsigned low = keep & 0xFF, high = keep >> 8;
+        __m128i shuffle = _mm_loadl_epi64((const __m128i*) byte_shuffle[low]);
+        _mm_storel_epi64((__m128i*) (data + kept), _mm_shuffle_epi8(chars, shuffle));
+        kept += (size_t) __builtin_popcount(low);
+        shuffle = _mm_add_epi8(_mm_loadl_epi64((const __m128i*) byte_shuffle[high]), eight);
+        _mm_storel_epi64((__m128i*) (data + kept), _mm_shuffle_epi8(chars, shuffle));
+        kept += (size_t) __builtin_popcount(high);
+    }
+    return kept;
+}
+#endif
+
+// Compact data in place, dropping the values selected by filter.
+// Returns the number of values kept (their order is preserved)
+size_t filter_ints(int* data, size_t n, IntFilter filter, int low, int high) {
+    size_t kept = 0, i = 0;
+#ifdef SSSE3_KERNELS
+    if (has_ssse3()) {
+        kept = filter_ints_ssse3(data, n, filter, low, high);
+        i = n / 4 * 4;
+    }
+#endif
+    for (; i < n; i++)
+        if (keep_int(data[i], filter, low, high))
+            data[kept++] = data[i];
+    return kept;
+}
+
+// Compact data in place, dropping the chars that occur in set.
+// Returns the number of chars kept (their order is preserved)
+size_t filter_chars(char* data, size_t n, const char* set) {
+    unsigned char member[256] = {0};
+    size_t set_len = strlen(set);
+    for (size_t k = 0; k < set_len; k++)
+        member[(unsigned char) set[k]] = 1;
+    size_t kept = 0, i = 0;
+#ifdef SSSE3_KERNELS
+    if (has_ssse3()) {
+        kept = filter_chars_ssse3(data, n, set, set_len);
+        i = n / 16 * 16;
+    }
+#endif
+    for (; i < n; i++)
+        if (!member[(unsigned char) data[i]])
+            data[kept++] = data[i];
+    return kept;
+}
+
+// Erase all even ints from the vector
+void erase_even(Vector* vector) {
+    close_gap(vector);
+    vector->size = filter_ints(vector->data, vector->size, INT_EVEN, 0, 0);
+}
+
+// Erase all odd ints from the vector
+void erase_odd(Vector* vector) {
+    close_gap(vector);
+    vector->size = filter_ints(vector->data, vector->size, INT_ODD, 0, 0);
+}
+
+// Erase all ints in [low, high] from the vector
+void erase_int_range(Vector* vector, int low, int high) {
+    close_gap(vector);
+    vector->size = filter_ints(vector->data, vector->size, INT_RANGE, low, high);
+}
+
+// Erase all chars that occur in set from the vector
+void erase_char_set(Vector* vector, const char* set) {
+    close_gap(vector);
+    vector->size = filter_chars(vector->data, vector->size, set);
+}
+
+// Erase all elements that satisfy the predicate from the vector.
+// Built-in predicates on matching element types use the vectorized filters
 void erase_if(Vector* vector, int (* predicate)(void*)) {
-    for (size_t idx = 0; idx < vector->size;) {
-        if (predicate(((char*) (vector->data)) + (vector->element_size * idx)))
-            erase(vector, idx);
-        else idx++;
+    if (vector->element_size == sizeof(int) && predicate == is_even) {
+        erase_even(vector);
+        return;
+    }
+    if (vector->element_size == sizeof(int) && predicate == is_odd) {
+        erase_odd(vector);
+        return;
+    }
+    if (vector->element_size == sizeof(char) && predicate == is_vowel) {
+        erase_char_set(vector, VOWELS);
+        return;
+    }
+    close_gap(vector);
+    char* data = vector->data;
+    size_t kept = 0;
+    for (size_t idx = 0; idx < vector->size; idx++) {
+        char* position = data + (vector->element_size * idx);
+        if (predicate(position)) continue;
+        if (kept != idx)
+            memcpy(data + (vector->element_size * kept), position, vector->element_size);
+        kept++;
+    }
+    vector->size = kept;
+}
+
+// part of the vector handled by one thread of erase_if_parallel()
+typedef struct EraseChunk {
+    Vector* vector;
+    predicate_ptr predicate;
+    char* scratch;
+    size_t first; // chunk is [first, last)
+    size_t last;
+    size_t kept; // survivors, compacted to [first, first + kept)
+    size_t offset; // final position of the first survivor
+} EraseChunk;
+
+// phase 1: test the predicate and compact the survivors within the chunk
+void* compact_chunk(void* arg) {
+    EraseChunk* chunk = arg;
+    size_t es = chunk->vector->element_size;
+    char* data = chunk->vector->data;
+    size_t kept = chunk->first;
+    for (size_t idx = chunk->first; idx < chunk->last; idx++) {
+        char* position = data + es * idx;
+        if (chunk->predicate(position)) continue;
+        if (kept != idx)
+            memcpy(data + es * kept, position, es);
+        kept++;
+    }
+    chunk->kept = kept - chunk->first;
+    return NULL;
+}
+
+// phase 2: copy the survivors to their final position in the scratch buffer
+void* scatter_chunk(void* arg) {
+    EraseChunk* chunk = arg;
+    size_t es = chunk->vector->element_size;
+    memcpy(chunk->scratch + es * chunk->offset, (char*) (chunk->vector->data) + es * chunk->first, es * chunk->kept);
+    return NULL;
+}
+
+// phase 3: copy them back into the vector
+void* gather_chunk(void* arg) {
+    EraseChunk* chunk = arg;
+    size_t es = chunk->vector->element_size;
+    memcpy((char*) (chunk->vector->data) + es * chunk->offset, chunk->scratch + es * chunk->offset, es * chunk->kept);
+    return NULL;
+}
+
+// Run work on every chunk, one thread each; the caller takes chunk 0
+// (and any chunk whose thread could not be started)
+void run_chunks(EraseChunk* chunks, int count, void* (* work)(void*)) {
+    pthread_t threads[MAX_THREADS];
+    int started[MAX_THREADS];
+    for (int t = 1; t < count; t++) {
+        started[t] = !pthread_create(&threads[t], NULL, work, &chunks[t]);
+        if (!started[t]) work(&chunks[t]);
     }
+    work(&chunks[0]);
+    for (int t = 1; t < count; t++)
+        if (started[t]) pthread_join(threads[t], NULL);
 }
 
-// Request the removal of unused capacity
-void shrink_to_fit(Vector* vector) {
-    vector->data = realloc(vector->data, vector->size * vector->element_size);
+// Erase all elements that satisfy the predicate using up to threads threads
+// (0 or less: one per online CPU). The predicate must be safe to call
+// concurrently. Survivors keep their order: every chunk is compacted in
+// parallel, a prefix sum of the survivor counts gives each chunk its final
+// offset, and the chunks are scattered there through a scratch buffer.
+// Built-in predicates and small vectors are handled by erase_if()
+void erase_if_parallel(Vector* vector, predicate_ptr predicate, int threads) {
+    if (threads <= 0) threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+    if (threads <= 1 || vector->size < PARALLEL_MIN_ELEMENTS ||
+        predicate == is_even || predicate == is_odd || predicate == is_vowel) {
+        erase_if(vector, predicate);
+        return;
+    }
+    EraseChunk chunks[MAX_THREADS];
+    close_gap(vector);
+    size_t step = (vector->size + (size_t) threads - 1) / (size_t) threads;
+    for (int t = 0; t < threads; t++) {
+        chunks[t].vector = vector;
+        chunks[t].predicate = predicate;
+        chunks[t].first = step * (size_t) t < vector->size ? step * (size_t) t : vector->size;
+        chunks[t].last = chunks[t].first + step < vector->size ? chunks[t].first + step : vector->size;
+    }
+    run_chunks(chunks, threads, compact_chunk);
+    size_t total = 0;
+    for (int t = 0; t < threads; t++) {
+        chunks[t].offset = total;
+        total += chunks[t].kept;
+    }
+    char* scratch = malloc(total * vector->element_size);
+    if (scratch != NULL) {
+        for (int t = 0; t < threads; t++)
+            chunks[t].scratch = scratch;
+        run_chunks(chunks, threads, scatter_chunk);
+        run_chunks(chunks, threads, gather_chunk);
+        free(scratch);
+    } else {
+        // no scratch: move the blocks down one after another, which is always safe
+        for (int t = 0; t < threads; t++)
+            memmove((char*) (vector->data) + vector->element_size * chunks[t].offset,
+                    (char*) (vector->data) + vector->element_size * chunks[t].first,
+                    vector->element_size * chunks[t].kept);
+    }
+    vector->size = total;
+}
+
+// Request the removal of unused capacity.
+// Returns 0 on success, -1 on allocation failure
+int shrink_to_fit(Vector* vector) {
+    if (move_storage(vector, vector->size * vector->element_size)) return -1;
     vector->capacity = vector->size;
+    return 0;
+}
+
+// Sort the vector by cmp and remember it for the sorted operations
+void sort_vector(Vector* vector, cmp_ptr cmp) {
+    close_gap(vector);
+    qsort(vector->data, vector->size, vector->element_size, cmp);
+    vector->sorted_by = cmp;
+}
+
+// Insert value after the elements not greater than it, keeping the vector sorted by cmp.
+// Returns 0 on success, -1 on allocation failure
+int insert_sorted(Vector* vector, const void* value, cmp_ptr cmp) {
+    cmp_ptr sorted_by = vector->sorted_by;
+    void* position = emplace(vector, upper_bound(vector, value, cmp));
+    if (position == NULL) return -1;
+    memcpy(position, value, vector->element_size);
+    vector->sorted_by = sorted_by;
+    return 0;
+}
+
+// Remove consecutive duplicates (by cmp), keeping the first of each run
+void dedup(Vector* vector, cmp_ptr cmp) {
+    if (vector->size == 0) return;
+    close_gap(vector);
+    char* data = vector->data;
+    size_t kept = 1;
+    for (size_t idx = 1; idx < vector->size; idx++) {
+        char* position = data + (vector->element_size * idx);
+        if (!cmp(data + (vector->element_size * (kept - 1)), position)) continue;
+        if (kept != idx)
+            memcpy(data + (vector->element_size * kept), position, vector->element_size);
+        kept++;
+    }
+    vector->size = kept;
+}
+
+// What merge_sorted() keeps from the two inputs
+typedef enum SetOperation {
+    SET_UNION,
+    SET_INTERSECTION,
+    SET_DIFFERENCE
+} SetOperation;
+
+// Merge a and b (both sorted by cmp) into result, replacing its contents.
+// Equal elements are matched one to one, as in a multiset.
+// result must be initialized with the same element_size and be neither a nor b.
+// Returns 0 on success, -1 on allocation failure
+int merge_sorted(Vector* result, const Vector* a, const Vector* b, cmp_ptr cmp, SetOperation operation) {
+    size_t i = 0, j = 0;
+    clear(result);
+    if (reserve(result, operation == SET_UNION ? a->size + b->size : a->size)) return -1;
+    while (i < a->size && j < b->size) {
+        int order = cmp(element_at(a, i), element_at(b, j));
+        if (order < 0) {
+            if (operation != SET_INTERSECTION) append_range(result, element_at(a, i), 1);
+            i++;
+        } else if (order > 0) {
+            if (operation == SET_UNION) append_range(result, element_at(b, j), 1);
+            j++;
+        } else {
+            if (operation != SET_DIFFERENCE) append_range(result, element_at(a, i), 1);
+            i++;
+            j++;
+        }
+    }
+    for (; operation != SET_INTERSECTION && i < a->size; i++)
+        append_range(result, element_at(a, i), 1);
+    for (; operation == SET_UNION && j < b->size; j++)
+        append_range(result, element_at(b, j), 1);
+    result->sorted_by = cmp;
+    return 0;
+}
+
+// Elements of a or b (each as many times as in the one having more)
+int set_union(Vector* result, const Vector* a, const Vector* b, cmp_ptr cmp) {
+    return merge_sorted(result, a, b, cmp, SET_UNION);
+}
+
+// Elements of both a and b
+int set_intersection(Vector* result, const Vector* a, const Vector* b, cmp_ptr cmp) {
+    return merge_sorted(result, a, b, cmp, SET_INTERSECTION);
+}
+
+// Elements of a not matched in b
+int set_difference(Vector* result, const Vector* a, const Vector* b, cmp_ptr cmp) {
+    return merge_sorted(result, a, b, cmp, SET_DIFFERENCE);
+}
+
+// --- copy-on-write vectors
+
+void release_chunk(CowChunk* chunk) {
+    if (atomic_fetch_sub_explicit(&chunk->references, 1, memory_order_acq_rel) == 1)
+        free(chunk);
+}
+
+// Drop a reference to a snapshot (or table); the last one frees it
+void release_snapshot(const CowTable* snapshot) {
+    CowTable* table = (CowTable*) snapshot;
+    if (atomic_fetch_sub_explicit(&table->references, 1, memory_order_acq_rel) != 1) return;
+    for (size_t k = 0; k < table->chunk_count; k++)
+        release_chunk(table->chunks[k]);
+    free(table);
+}
+
+size_t snapshot_size(const CowTable* snapshot) {
+    return snapshot->size;
+}
+
+// Address of element index of a snapshot (or of the writer's table)
+const void* snapshot_at(const CowTable* snapshot, size_t index) {
+    return (const char*) (snapshot->chunks[index / COW_CHUNK]->data) + snapshot->element_size * (index % COW_CHUNK);
+}
+
+CowTable* create_table(size_t element_size, size_t chunk_capacity) {
+    CowTable* table = malloc(sizeof(CowTable) + chunk_capacity * sizeof(CowChunk*));
+    if (table == NULL) return NULL;
+    atomic_init(&table->references, 1);
+    table->element_size = element_size;
+    table->size = 0;
+    table->chunk_count = 0;
+    table->chunk_capacity = chunk_capacity;
+    return table;
+}
+
+// Returns 0 on success, -1 on allocation failure
+int cow_init(CowVector* vector, size_t element_size) {
+    vector->table = create_table(element_size, 4);
+    return vector->table == NULL ? -1 : 0;
+}
+
+void cow_free(CowVector* vector) {
+    release_snapshot(vector->table);
+    vector->table = NULL;
+}
+
+// O(1) read-only view of the current contents, released with release_snapshot()
+const CowTable* cow_snapshot(CowVector* vector) {
+    atomic_fetch_add_explicit(&vector->table->references, 1, memory_order_relaxed);
+    return vector->table;
+}
+
+size_t cow_size(const CowVector* vector) {
+    return vector->table->size;
+}
+
+const void* cow_at(const CowVector* vector, size_t index) {
+    return snapshot_at(vector->table, index);
+}
+
+// Make the table private to the writer (copying it if a snapshot shares it)
+// with room for chunk_count chunks. Returns 0 on success, -1 on allocation failure
+int own_table(CowVector* vector, size_t chunk_count) {
+    CowTable* table = vector->table;
+    int shared = atomic_load_explicit(&table->references, memory_order_acquire) > 1;
+    if (!shared && chunk_count <= table->chunk_capacity) return 0;
+    size_t capacity = table->chunk_capacity;
+    while (capacity < chunk_count) capacity *= 2;
+    if (!shared) {
+        table = realloc(table, sizeof(CowTable) + capacity * sizeof(CowChunk*));
+        if (table == NULL) return -1;
+        table->chunk_capacity = capacity;
+        vector->table = table;
+        return 0;
+    }
+    CowTable* copy = create_table(table->element_size, capacity);
+    if (copy == NULL) return -1;
+    copy->size = table->size;
+    copy->chunk_count = table->chunk_count;
+    for (size_t k = 0; k < table->chunk_count; k++) {
+        copy->chunks[k] = table->chunks[k];
+        atomic_fetch_add_explicit(&copy->chunks[k]->references, 1, memory_order_relaxed);
+    }
+    release_snapshot(table);
+    vector->table = copy;
+    return 0;
+}
+
+// Make chunk k of the (already owned) table private to the writer.
+// Returns its data, NULL on allocation failure
+char* own_chunk(CowVector* vector, size_t k) {
+    CowTable* table = vector->table;
+    CowChunk* chunk = table->chunks[k];
+    if (atomic_load_explicit(&chunk->references, memory_order_acquire) > 1) {
+        CowChunk* copy = malloc(sizeof(CowChunk) + COW_CHUNK * table->element_size);
+        if (copy == NULL) return NULL;
+        atomic_init(&copy->references, 1);
+        memcpy(copy->data, chunk->data, COW_CHUNK * table->element_size);
+        release_chunk(chunk);
+        table->chunks[k] = chunk = copy;
+    }
+    return (char*) chunk->data;
+}
+
+// Returns 0 on success, -1 on allocation failure
+int cow_push_back(CowVector* vector, const void* value) {
+    size_t size = vector->table->size;
+    size_t k = size / COW_CHUNK;
+    if (own_table(vector, k + 1)) return -1;
+    CowTable* table = vector->table;
+    if (k == table->chunk_count) {
+        CowChunk* chunk = malloc(sizeof(CowChunk) + COW_CHUNK * table->element_size);
+        if (chunk == NULL) return -1;
+        atomic_init(&chunk->references, 1);
+        table->chunks[table->chunk_count++] = chunk;
+    }
+    char* data = own_chunk(vector, k);
+    if (data == NULL) return -1;
+    memcpy(data + table->element_size * (size % COW_CHUNK), value, table->element_size);
+    table->size++;
+    return 0;
+}
+
+// Give back the chunks past the last element
+void trim_chunks(CowTable* table) {
+    size_t needed = (table->size + COW_CHUNK - 1) / COW_CHUNK;
+    while (table->chunk_count > needed)
+        release_chunk(table->chunks[--table->chunk_count]);
+}
+
+// Erase element at position index, shifting the later elements down;
+// chunks are copied only if a snapshot still shares them.
+// Returns 0 on success, -1 on allocation failure
+int cow_erase(CowVector* vector, size_t index) {
+    if (own_table(vector, vector->table->chunk_count)) return -1;
+    CowTable* table = vector->table;
+    size_t es = table->element_size;
+    for (size_t idx = index + 1; idx < table->size; idx++) {
+        char* data = own_chunk(vector, (idx - 1) / COW_CHUNK);
+        if (data == NULL) return -1;
+        memcpy(data + es * ((idx - 1) % COW_CHUNK), snapshot_at(table, idx), es);
+    }
+    table->size--;
+    trim_chunks(table);
+    return 0;
+}
+
+// Erase all elements that satisfy the predicate. Only chunks that receive a
+// moved element are written (and copied first if shared); snapshots keep
+// seeing the contents from before the call.
+// Returns 0 on success, -1 on allocation failure
+int cow_erase_if(CowVector* vector, predicate_ptr predicate) {
+    if (own_table(vector, vector->table->chunk_count)) return -1;
+    CowTable* table = vector->table;
+    size_t es = table->element_size;
+    size_t kept = 0;
+    for (size_t idx = 0; idx < table->size; idx++) {
+        if (predicate((void*) snapshot_at(table, idx))) continue;
+        if (kept != idx) {
+            char* data = own_chunk(vector, kept / COW_CHUNK);
+            if (data == NULL) return -1;
+            memcpy(data + es * (kept % COW_CHUNK), snapshot_at(table, idx), es);
+        }
+        kept++;
+    }
+    table->size = kept;
+    trim_chunks(table);
+    return 0;
+}
+
+// --- compressed int vectors
+
+// Compress the int vector into packed.
+// Returns 0 on success, -1 on allocation failure
+int pack_ints(PackedInts* packed, const Vector* vector) {
+    size_t block_count = (vector->size + PACK_BLOCK - 1) / PACK_BLOCK;
+    size_t word_count = 0;
+    packed->size = vector->size;
+    packed->blocks = malloc(block_count * sizeof(PackedBlock));
+    packed->words = NULL;
+    if (packed->blocks == NULL && block_count > 0) return -1;
+    for (size_t b = 0; b < block_count; b++) {
+        size_t first = b * PACK_BLOCK;
+        size_t last = first + PACK_BLOCK < vector->size ? first + PACK_BLOCK : vector->size;
+        int low = *(int*) element_at(vector, first), high = low;
+        for (size_t i = first + 1; i < last; i++) {
+            int value = *(int*) element_at(vector, i);
+            if (value < low) low = value;
+            if (value > high) high = value;
+        }
+        uint32_t range = (uint32_t) high - (uint32_t) low;
+        packed->blocks[b].reference = low;
+        packed->blocks[b].width = range ? 32 - (unsigned) __builtin_clz(range) : 0;
+        packed->blocks[b].offset = word_count;
+        word_count += 4 * packed->blocks[b].width;
+    }
+    packed->words = calloc(word_count ? word_count : 1, sizeof(uint32_t));
+    if (packed->words == NULL) {
+        free(packed->blocks);
+        return -1;
+    }
+    for (size_t i = 0; i < vector->size; i++) {
+        const PackedBlock* block = &packed->blocks[i / PACK_BLOCK];
+        if (block->width == 0) continue;
+        size_t j = i % PACK_BLOCK, bit = j / 4 * block->width;
+        uint32_t* words = packed->words + block->offset + j % 4;
+        uint32_t delta = (uint32_t) *(int*) element_at(vector, i) - (uint32_t) block->reference;
+        words[bit / 32 * 4] |= delta << (bit % 32);
+        if (bit % 32 + block->width > 32)
+            words[(bit / 32 + 1) * 4] |= delta >> (32 - bit % 32);
+    }
+    return 0;
+}
+
+// Value at index, decoded in O(1)
+int packed_get(const PackedInts* packed, size_t index) {
+    const PackedBlock* block = &packed->blocks[index / PACK_BLOCK];
+    if (block->width == 0) return block->reference;
+    size_t j = index % PACK_BLOCK, bit = j / 4 * block->width;
+    const uint32_t* words = packed->words + block->offset + j % 4;
+    uint64_t bits = words[bit / 32 * 4];
+    if (bit % 32 + block->width > 32)
+        bits |= (uint64_t) words[(bit / 32 + 1) * 4] << 32;
+    uint32_t mask = block->width == 32 ? UINT32_MAX : (1u << block->width) - 1;
+    return (int) ((uint32_t) block->reference + ((uint32_t) (bits >> (bit % 32)) & mask));
+}
+
+// Decode a whole block into out (PACK_BLOCK values, even past size)
+void unpack_block(const PackedInts* packed, size_t b, int* out) {
+    const PackedBlock* block = &packed->blocks[b];
+    unsigned width = block->width;
+    if (width == 0) {
+        for (size_t j = 0; j < PACK_BLOCK; j++)
+            out[j] = block->reference;
+        return;
+    }
+#ifdef __SSE2__
+    const __m128i* in = (const __m128i*) (packed->words + block->offset);
+    const __m128i mask = _mm_set1_epi32(width == 32 ? -1 : (int) ((1u << width) - 1));
+    const __m128i reference = _mm_set1_epi32(block->reference);
+    for (unsigned slot = 0; slot < PACK_BLOCK / 4; slot++) {
+        unsigned bit = slot * width, shift = bit % 32;
+        __m128i values = _mm_srl_epi32(_mm_loadu_si128(in + bit / 32), _mm_cvtsi32_si128((int) shift));
+        if (shift + width > 32)
+            values = _mm_or_si128(values, _mm_sll_epi32(_mm_loadu_si128(in + bit / 32 + 1),
+                                                         _mm_cvtsi32_si128((int) (32 - shift))));
+        values = _mm_add_epi32(_mm_and_si128(values, mask), reference);
+        _mm_storeu_si128((__m128i*) (out + 4 * slot), values);
+    }
+#else
+    PackedInts whole = {(b + 1) * PACK_BLOCK, packed->blocks, packed->words};
+    for (size_t j = 0; j < PACK_BLOCK; j++)
+        out[j] = packed_get(&whole, b * PACK_BLOCK + j);
+#endif
+}
+
+// Decode all values into the int vector (replacing its contents).
+// Returns 0 on success, -1 on allocation failure
+int unpack_ints(const PackedInts* packed, Vector* vector) {
+    int buffer[PACK_BLOCK];
+    clear(vector);
+    if (resize(vector, packed->size)) return -1;
+    int* out = vector->data;
+    for (size_t first = 0; first < packed->size; first += PACK_BLOCK) {
+        if (packed->size - first >= PACK_BLOCK)
+            unpack_block(packed, first / PACK_BLOCK, out + first);
+        else {
+            unpack_block(packed, first / PACK_BLOCK, buffer);
+            memcpy(out + first, buffer, (packed->size - first) * sizeof(int));
+        }
+    }
+    return 0;
+}
+
+// Bytes used by the packed values and their block index
+size_t packed_bytes(const PackedInts* packed) {
+    size_t block_count = (packed->size + PACK_BLOCK - 1) / PACK_BLOCK;
+    size_t words = block_count ? packed->blocks[block_count - 1].offset + 4 * packed->blocks[block_count - 1].width : 0;
+    return block_count * sizeof(PackedBlock) + words * sizeof(uint32_t);
+}
+
+void free_packed(PackedInts* packed) {
+    free(packed->blocks);
+    free(packed->words);
+    packed->blocks = NULL;
+    packed->words = NULL;
+    packed->size = 0;
 }
 
 // integer comparator
@@ -145,6 +1357,11 @@ int is_even(void* value) {
     return !(*((int*) value) % 2);
 }
 
+// predicate: check if number is odd
+int is_odd(void* value) {
+    return *((int*) value) % 2 != 0;
+}
+
 // predicate: check if char is a vowel
 int is_vowel(void* value) {
     char c = *((char*) value);
@@ -162,6 +1379,123 @@ int is_older_than_25(void* person) {
     return ((Person*) person)->age > 25;
 }
 
+// --- typed vectors: VEC_DEFINE(name, T, cmp) defines struct name holding
+// T elements and name_* functions using plain assignment, sizeof(T) moves
+// and direct calls of cmp(const T*, const T*), which the compiler inlines
+
+#define VEC_DEFINE(name, T, cmp)                                                   \
+typedef struct name {                                                             \
+    T* data;                                                                      \
+    size_t size;                                                                  \
+    size_t capacity;                                                              \
+} name;                                                                           \
+                                                                                  \
+static inline int name##_reserve(name* vector, size_t new_capacity) {             \
+    if (new_capacity <= vector->capacity) return 0;                               \
+    if (new_capacity > SIZE_MAX / sizeof(T)) return -1;                           \
+    T* data = realloc(vector->data, new_capacity * sizeof(T));                    \
+    if (data == NULL) return -1;                                                  \
+    vector->data = data;                                                          \
+    vector->capacity = new_capacity;                                              \
+    return 0;                                                                     \
+}                                                                                 \
+                                                                                  \
+static inline int name##_init(name* vector, size_t block_size) {                  \
+    vector->data = NULL;                                                          \
+    vector->size = 0;                                                             \
+    vector->capacity = 0;                                                         \
+    return name##_reserve(vector, block_size);                                    \
+}                                                                                 \
+                                                                                  \
+static inline void name##_free(name* vector) {                                    \
+    free(vector->data);                                                           \
+    vector->data = NULL;                                                          \
+    vector->size = 0;                                                             \
+    vector->capacity = 0;                                                         \
+}                                                                                 \
+                                                                                  \
+static inline int name##_grow(name* vector) {                                     \
+    return name##_reserve(vector, vector->capacity ? vector->capacity * 2 : 1);   \
+}                                                                                 \
+                                                                                  \
+static inline int name##_push_back(name* vector, T value) {                       \
+    if (vector->size == vector->capacity && name##_grow(vector)) return -1;       \
+    vector->data[vector->size++] = value;                                         \
+    return 0;                                                                     \
+}                                                                                 \
+                                                                                  \
+static inline int name##_insert(name* vector, size_t index, T value) {            \
+    if (vector->size == vector->capacity && name##_grow(vector)) return -1;       \
+    memmove(vector->data + index + 1, vector->data + index,                       \
+            (vector->size - index) * sizeof(T));                                  \
+    vector->data[index] = value;                                                  \
+    vector->size++;                                                               \
+    return 0;                                                                     \
+}                                                                                 \
+                                                                                  \
+static inline void name##_erase(name* vector, size_t index) {                     \
+    memmove(vector->data + index, vector->data + index + 1,                       \
+            (vector->size - index - 1) * sizeof(T));                              \
+    vector->size--;                                                               \
+}                                                                                 \
+                                                                                  \
+static inline void name##_erase_if(name* vector, int (* predicate)(T*)) {         \
+    size_t kept = 0;                                                              \
+    for (size_t idx = 0; idx < vector->size; idx++)                               \
+        if (!predicate(&vector->data[idx]))                                       \
+            vector->data[kept++] = vector->data[idx];                             \
+    vector->size = kept;                                                          \
+}                                                                                 \
+                                                                                  \
+static inline void name##_erase_value(name* vector, const T* value) {             \
+    size_t kept = 0;                                                              \
+    for (size_t idx = 0; idx < vector->size; idx++)                               \
+        if (cmp(&vector->data[idx], value))                                       \
+            vector->data[kept++] = vector->data[idx];                             \
+    vector->size = kept;                                                          \
+}                                                                                 \
+                                                                                  \
+static inline void name##_sort_range(T* data, ptrdiff_t n) {                      \
+    while (n > 16) {                                                              \
+        T pivot = data[n / 2];                                                    \
+        ptrdiff_t i = 0, j = n - 1;                                               \
+        while (i <= j) {                                                          \
+            while (cmp(&data[i], &pivot) < 0) i++;                                \
+            while (cmp(&data[j], &pivot) > 0) j--;                                \
+            if (i <= j) {                                                         \
+                T tmp = data[i];                                                  \
+                data[i++] = data[j];                                              \
+                data[j--] = tmp;                                                  \
+            }                                                                     \
+        }                                                                         \
+        if (j + 1 < n - i) {                                                      \
+            name##_sort_range(data, j + 1);                                       \
+            data += i;                                                            \
+            n -= i;                                                               \
+        } else {                                                                  \
+            name##_sort_range(data + i, n - i);                                   \
+            n = j + 1;                                                            \
+        }                                                                         \
+    }                                                                             \
+    for (ptrdiff_t i = 1; i < n; i++) {                                           \
+        T value = data[i];                                                        \
+        ptrdiff_t j = i;                                                          \
+        for (; j > 0 && cmp(&value, &data[j - 1]) < 0; j--)                       \
+            data[j] = data[j - 1];                                                \
+        data[j] = value;                                                          \
+    }                                                                             \
+}                                                                                 \
+                                                                                  \
+static inline void name##_sort(name* vector) {                                    \
+    name##_sort_range(vector->data, (ptrdiff_t) vector->size);                    \
+}
+
+VEC_DEFINE(IntVector, int, int_cmp)
+
+VEC_DEFINE(CharVector, char, char_cmp)
+
+VEC_DEFINE(PersonVector, Person, person_cmp)
+
 // print integer value
 void print_int(const void* v) {
     printf("%d ", *((int*) v));
@@ -180,11 +1514,8 @@ void print_person(const void* v) {
 // print capacity of the vector and its elements
 void print_vector(Vector* vector, print_ptr print) {
     printf("%zu\n", vector->capacity);
-    void* position = vector->data;
-    for (size_t i = 0; i < vector->size; i++) {
-        print(position);
-        position += vector->element_size;
-    }
+    for (size_t i = 0; i < vector->size; i++)
+        print(element_at(vector, i));
 }
 
 // read int value
@@ -204,21 +1535,32 @@ void read_person(void* value) {
 
 void vector_test(Vector* vector, size_t block_size, size_t elem_size, int n, read_ptr read,
                  cmp_ptr cmp, predicate_ptr predicate, print_ptr print) {
-    init_vector(vector, block_size, elem_size);
-    void* v = malloc(vector->element_size);
+    if (init_vector(vector, block_size, elem_size)) {
+        printf("Allocation error\n");
+        return;
+    }
+    void* v = malloc(vector->element_size); // erase_value key, or input that did not fit
+    void* slot;
     size_t index, size;
+    int enabled;
     for (int i = 0; i < n; ++i) {
         char op;
         scanf(" %c", &op);
         switch (op) {
             case 'p': // push_back
-                read(v);
-                push_back(vector, v);
+                if ((slot = emplace_back(vector)) != NULL) read(slot);
+                else {
+                    read(v);
+                    printf("Allocation error\n");
+                }
                 break;
             case 'i': // insert
                 scanf("%zu", &index);
-                read(v);
-                insert(vector, index, v);
+                if ((slot = emplace(vector, index)) != NULL) read(slot);
+                else {
+                    read(v);
+                    printf("Allocation error\n");
+                }
                 break;
             case 'e': // erase
                 scanf("%zu", &index);
@@ -228,22 +1570,25 @@ void vector_test(Vector* vector, size_t block_size, size_t elem_size, int n, rea
                 read(v);
                 erase_value(vector, v, cmp);
                 break;
-            case 'd': // erase (predicate)
-                erase_if(vector, predicate);
+            case 'd': // erase (predicate), on all CPUs for big vectors
+                erase_if_parallel(vector, predicate, 0);
                 break;
             case 'r': // resize
                 scanf("%zu", &size);
-                resize(vector, size);
+                if (resize(vector, size)) printf("Allocation error\n");
                 break;
             case 'c': // clear
                 clear(vector);
                 break;
             case 'f': // shrink
-                shrink_to_fit(vector);
+                if (shrink_to_fit(vector)) printf("Allocation error\n");
                 break;
             case 's': // sort
-                qsort(vector->data, vector->size,
-                      vector->element_size, cmp);
+                sort_vector(vector, cmp);
+                break;
+            case 'g': // gap mode on (1) or off (0)
+                scanf("%d", &enabled);
+                set_gap_mode(vector, enabled);
                 break;
             default:
                 printf("No such operation: %c\n", op);
@@ -251,10 +1596,253 @@ void vector_test(Vector* vector, size_t block_size, size_t elem_size, int n, rea
         }
     }
     print_vector(vector, print);
-    free(vector->data);
+    free_vector(vector);
     free(v);
 }
 
+// push n ints read from input to a file-backed vector, then reopen the file and print it
+void file_test(int n) {
+    char path[] = "/tmp/vectorXXXXXX";
+    int fd = mkstemp(path);
+    Vector vector;
+    if (fd < 0) {
+        printf("File error\n");
+        return;
+    }
+    close(fd);
+    if (open_vector_file(&vector, path, 4, sizeof(int))) {
+        printf("File error\n");
+        unlink(path);
+        return;
+    }
+    for (int i = 0; i < n; ++i) {
+        int value;
+        read_int(&value);
+        if (push_back(&vector, &value)) printf("Allocation error\n");
+    }
+    free_vector(&vector); // writes the size to the file
+    if (open_vector_file(&vector, path, 4, sizeof(int))) printf("File error\n");
+    else {
+        print_vector(&vector, print_int);
+        free_vector(&vector);
+    }
+    unlink(path);
+}
+
+// read n int vectors (a size, then the values) into storage from one arena,
+// print them and free them all at once with free_arena()
+void arena_test(int n) {
+    Arena arena;
+    Vector* vectors = malloc((n > 0 ? (size_t) n : 1) * sizeof(Vector));
+    if (vectors == NULL) {
+        printf("Allocation error\n");
+        return;
+    }
+    init_arena(&arena, 0);
+    for (int i = 0; i < n; ++i) {
+        size_t size;
+        scanf("%zu", &size);
+        if (init_vector_with_allocator(&vectors[i], 4, sizeof(int), arena_allocator(&arena)))
+            printf("Allocation error\n");
+        for (size_t k = 0; k < size; k++) {
+            int value;
+            read_int(&value);
+            if (push_back(&vectors[i], &value)) printf("Allocation error\n");
+        }
+    }
+    for (int i = 0; i < n; ++i) {
+        print_vector(&vectors[i], print_int);
+        printf("\n");
+    }
+    free_arena(&arena);
+    free(vectors);
+}
+
+// sort n ints read from input ('s'), pack them and print the bytes they
+// take plain and packed, then the values decoded by unpack_ints(), which
+// must agree with packed_get()
+void packed_test(int n) {
+    Vector vector, unpacked;
+    PackedInts packed;
+    if (init_vector(&vector, 4, sizeof(int)) || init_vector(&unpacked, 4, sizeof(int))) {
+        printf("Allocation error\n");
+        return;
+    }
+    for (int i = 0; i < n; ++i) {
+        int value;
+        read_int(&value);
+        if (push_back(&vector, &value)) printf("Allocation error\n");
+    }
+    sort_vector(&vector, int_cmp);
+    if (pack_ints(&packed, &vector) || unpack_ints(&packed, &unpacked)) printf("Allocation error\n");
+    else {
+        printf("%zu %zu\n", vector.size * sizeof(int), packed_bytes(&packed));
+        for (size_t i = 0; i < unpacked.size; i++) {
+            if (packed_get(&packed, i) != *(int*) element_at(&unpacked, i)) printf("Packing error\n");
+            print_int(element_at(&unpacked, i));
+        }
+        free_packed(&packed);
+    }
+    free_vector(&vector);
+    free_vector(&unpacked);
+}
+
+// thread of cow_test() walking a snapshot
+typedef struct SnapshotReader {
+    const CowTable* snapshot;
+    size_t size;
+    long long sum;
+} SnapshotReader;
+
+void* read_snapshot(void* arg) {
+    SnapshotReader* reader = arg;
+    reader->size = snapshot_size(reader->snapshot);
+    reader->sum = 0;
+    for (size_t i = 0; i < reader->size; i++)
+        reader->sum += *(const int*) snapshot_at(reader->snapshot, i);
+    release_snapshot(reader->snapshot);
+    return NULL;
+}
+
+// push n ints read from input to a CowVector and erase the even ones with
+// cow_erase_if() while another thread sums a snapshot taken before, which
+// still holds all of them. Prints the snapshot's size and sum, then the vector
+void cow_test(int n) {
+    CowVector vector;
+    SnapshotReader reader;
+    pthread_t thread;
+    if (cow_init(&vector, sizeof(int))) {
+        printf("Allocation error\n");
+        return;
+    }
+    for (int i = 0; i < n; ++i) {
+        int value;
+        read_int(&value);
+        if (cow_push_back(&vector, &value)) printf("Allocation error\n");
+    }
+    reader.snapshot = cow_snapshot(&vector);
+    int started = !pthread_create(&thread, NULL, read_snapshot, &reader);
+    if (cow_erase_if(&vector, is_even)) printf("Allocation error\n");
+    if (started) pthread_join(thread, NULL);
+    else read_snapshot(&reader);
+    printf("%zu %lld\n", reader.size, reader.sum);
+    for (size_t i = 0; i < cow_size(&vector); i++)
+        print_int(cow_at(&vector, i));
+    cow_free(&vector);
+}
+
+// typed predicates for the benchmark
+int int_is_even(int* value) {
+    return is_even(value);
+}
+
+int char_is_vowel(char* value) {
+    return is_vowel(value);
+}
+
+int person_is_older_than_25(Person* person) {
+    return is_older_than_25(person);
+}
+
+// the built-in predicates under other names, which erase_if() does not
+// hand to the vectorized filters: the benchmark times its generic loop
+int any_is_even(void* value) {
+    return is_even(value);
+}
+
+int any_is_vowel(void* value) {
+    return is_vowel(value);
+}
+
+double seconds_since(clock_t start) {
+    return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+// Time push_back, insert near the end, sort and erase_if for the generic
+// Vector and the typed vector of the same element type.
+// The typed vector is named by prefix, values come from the expression make(i).
+#define BENCHMARK(label, prefix, T, n, make, cmp, predicate, typed_predicate)   \
+do {                                                                            \
+    Vector generic;                                                             \
+    prefix typed;                                                               \
+    size_t inserts = (n) / 100 + 1;                                             \
+    double times[2][4];                                                         \
+    init_vector(&generic, 4, sizeof(T));                                        \
+    prefix##_init(&typed, 4);                                                   \
+    clock_t start = clock();                                                    \
+    for (size_t i = 0; i < (n); i++) {                                          \
+        T value = make(i);                                                      \
+        push_back(&generic, &value);                                            \
+    }                                                                           \
+    times[0][0] = seconds_since(start);                                         \
+    start = clock();                                                            \
+    for (size_t i = 0; i < (n); i++)                                            \
+        prefix##_push_back(&typed, make(i));                                    \
+    times[1][0] = seconds_since(start);                                         \
+    start = clock();                                                            \
+    for (size_t i = 0; i < inserts; i++) {                                      \
+        T value = make(i);                                                      \
+        insert(&generic, generic.size - generic.size / 64, &value);             \
+    }                                                                           \
+    times[0][1] = seconds_since(start);                                         \
+    start = clock();                                                            \
+    for (size_t i = 0; i < inserts; i++)                                        \
+        prefix##_insert(&typed, typed.size - typed.size / 64, make(i));         \
+    times[1][1] = seconds_since(start);                                         \
+    start = clock();                                                            \
+    sort_vector(&generic, cmp);                                                 \
+    times[0][2] = seconds_since(start);                                         \
+    start = clock();                                                            \
+    prefix##_sort(&typed);                                                      \
+    times[1][2] = seconds_since(start);                                         \
+    start = clock();                                                            \
+    erase_if(&generic, predicate);                                              \
+    times[0][3] = seconds_since(start);                                         \
+    start = clock();                                                            \
+    prefix##_erase_if(&typed, typed_predicate);                                 \
+    times[1][3] = seconds_since(start);                                         \
+    printf("%s (generic / typed, s): push_back %.3f / %.3f, insert %.3f / %.3f, "    \
+           "sort %.3f / %.3f, erase_if %.3f / %.3f\n", label,                  \
+           times[0][0], times[1][0], times[0][1], times[1][1],                  \
+           times[0][2], times[1][2], times[0][3], times[1][3]);                 \
+    free_vector(&generic);                                                      \
+    prefix##_free(&typed);                                                      \
+} while (0)
+
+// pseudo-random benchmark values: the index through a hash finalizer
+uint32_t mix(size_t i) {
+    uint32_t x = (uint32_t) i;
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+int make_int(size_t i) {
+    return (int) (mix(i) % 1000003);
+}
+
+char make_char(size_t i) {
+    return (char) ('a' + mix(i) % 26);
+}
+
+Person make_person(size_t i) {
+    Person person = {(int) (mix(i) % 80), "", ""};
+    snprintf(person.first_name, MAX_STR_LEN, "name%u", mix(i + 1) % 1000);
+    snprintf(person.last_name, MAX_STR_LEN, "surname%u", mix(i + 2) % 1000);
+    return person;
+}
+
+// compare the generic Vector with the VEC_DEFINE vectors on n elements
+void benchmark(size_t n) {
+    BENCHMARK("int", IntVector, int, n, make_int, int_cmp, any_is_even, int_is_even);
+    BENCHMARK("char", CharVector, char, n, make_char, char_cmp, any_is_vowel, char_is_vowel);
+    BENCHMARK("Person", PersonVector, Person, n, make_person, person_cmp,
+              is_older_than_25, person_is_older_than_25);
+}
+
 int main(void) {
     int to_do, n;
     Vector vector_int, vector_char, vector_person;
@@ -274,6 +1862,21 @@ int main(void) {
             vector_test(&vector_person, 2, sizeof(Person), n, read_person,
                         person_cmp, is_older_than_25, print_person);
             break;
+        case 4: // typed vs generic vectors
+            benchmark((size_t) n);
+            break;
+        case 5: // file-backed vector: write n ints, reopen and print
+            file_test(n);
+            break;
+        case 6: // n int vectors on one arena
+            arena_test(n);
+            break;
+        case 7: // n ints sorted and packed
+            packed_test(n);
+            break;
+        case 8: // copy-on-write vector read by another thread during an erase
+            cow_test(n);
+            break;
         default:
             printf("Nothing to do for %d\n", to_do);
             break;
@@ -3,8 +3,17 @@
 #include <string.h>
 #include <ctype.h>
 #include <stdbool.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
 
 #define BUFFER_SIZE 1024
+#define SKIP_MAX_LEVEL 32
+#define HASH_MIN_SLOTS 64
+#define UNROLL_CAPACITY 14 // data pointers per node of an UnrolledList (128-byte nodes)
+#define POOL_NIL UINT32_MAX // "no element" index of a PoolList
 
 struct List;
 
@@ -14,11 +23,44 @@ typedef void (* ConstDataFp)(const void*);
 
 typedef int (* CompareDataFp)(const void*, const void*);
 
+typedef size_t (* HashDataFp)(const void*);
+
 typedef struct ListElement {
     struct ListElement* next;
     void* data;
 } ListElement;
 
+// skip list node indexing one list element
+typedef struct SkipNode {
+    ListElement* element;
+    int level;
+    struct SkipNode* forward[];
+} SkipNode;
+
+// optional skip list over a list sorted by compare
+typedef struct SkipIndex {
+    CompareDataFp compare;
+    int level; // levels in use
+    SkipNode* header; // SKIP_MAX_LEVEL forward pointers, no element
+} SkipIndex;
+
+// hash table slot indexing one list element, element NULL if the slot is free
+typedef struct HashSlot {
+    ListElement* element;
+    size_t hash;
+} HashSlot;
+
+// optional hash set over the list elements; hash must agree with compare
+// (elements equal by compare have equal hashes). Open addressing with linear
+// probing: no allocation per element
+typedef struct HashIndex {
+    HashDataFp hash;
+    CompareDataFp compare;
+    size_t size;
+    size_t slot_count; // power of 2, at least twice size
+    HashSlot* slots;
+} HashIndex;
+
 typedef struct {
     ListElement* head;
     ListElement* tail;
@@ -26,8 +68,60 @@ typedef struct {
     DataFp free_data;
     CompareDataFp compare_data;
     DataFp modify_data;
+    SkipIndex* skip_index;
+    HashIndex* hash_index;
+    bool intrusive; // data starts with its own ListElement, see init_intrusive_list()
 } List;
 
+// node of an UnrolledList: its elements are data[first .. first + count)
+typedef struct UnrolledNode {
+    struct UnrolledNode* next;
+    int first;
+    int count;
+    void* data[UNROLL_CAPACITY];
+} UnrolledNode;
+
+// List variant storing several data pointers per node,
+// with the same callbacks and operations as List
+typedef struct {
+    UnrolledNode* head;
+    UnrolledNode* tail;
+    ConstDataFp dump_data;
+    DataFp free_data;
+    CompareDataFp compare_data;
+    DataFp modify_data;
+} UnrolledList;
+
+// node of a QueueList; the first node is a dummy whose data was already taken
+typedef struct QueueNode {
+    _Atomic(struct QueueNode*) next;
+    void* data;
+} QueueNode;
+
+// List variant used as a work queue: push_back is lock-free and may be called
+// from any number of threads, pop_front from a single consumer thread
+typedef struct {
+    _Atomic(QueueNode*) tail; // producers' end
+    QueueNode* head; // consumer's end (the dummy)
+    DataFp free_data;
+} QueueList;
+
+// List variant keeping its elements in a pool: element i is data[i], linked
+// by 32-bit indices in next[i]; popped slots go to a free list
+typedef struct {
+    void** data;
+    uint32_t* next;
+    uint32_t capacity;
+    uint32_t used; // slots ever taken, the rest of the pool is untouched
+    uint32_t head;
+    uint32_t tail;
+    uint32_t free_head;
+    ConstDataFp dump_data;
+    DataFp free_data;
+    CompareDataFp compare_data;
+    DataFp modify_data;
+} PoolList;
+
 void* safe_malloc(size_t size) {
     void* ptr = malloc(size);
     if (ptr) return ptr;
@@ -35,10 +129,10 @@ void* safe_malloc(size_t size) {
     exit(EXIT_FAILURE);
 }
 
-void* safe_strdup(const char* string) {
-    void* ptr = strdup(string);
+void* safe_realloc(void* ptr, size_t size) {
+    ptr = realloc(ptr, size);
     if (ptr) return ptr;
-    printf("strdup error\n");
+    printf("realloc error\n");
     exit(EXIT_FAILURE);
 }
 
@@ -52,6 +146,180 @@ void init_list(List* p_list, ConstDataFp dump_data, DataFp free_data,
     p_list->free_data = free_data;
     p_list->compare_data = compare_data;
     p_list->modify_data = modify_data;
+    p_list->skip_index = NULL;
+    p_list->hash_index = NULL;
+    p_list->intrusive = false;
+}
+
+// List whose data begins with a ListElement member used as the link:
+// no allocation per element, free_data frees the link together with the data
+void init_intrusive_list(List* p_list, ConstDataFp dump_data, DataFp free_data,
+                         CompareDataFp compare_data, DataFp modify_data) {
+    init_list(p_list, dump_data, free_data, compare_data, modify_data);
+    p_list->intrusive = true;
+}
+
+// Element holding data: allocated, or the link embedded in an intrusive data
+ListElement* create_element(const List* p_list, void* data) {
+    ListElement* element = p_list->intrusive ? data : safe_malloc(sizeof(ListElement));
+    element->data = data;
+    return element;
+}
+
+// --- skip list index: O(log n) ordered insert and duplicate detection
+
+SkipNode* create_skip_node(ListElement* element, int level) {
+    SkipNode* node = safe_malloc(sizeof(SkipNode) + level * sizeof(SkipNode*));
+    node->element = element;
+    node->level = level;
+    for (int i = 0; i < level; i++)
+        node->forward[i] = NULL;
+    return node;
+}
+
+int random_level(void) {
+    int level = 1;
+    while (level < SKIP_MAX_LEVEL && (rand() & 3) == 0)
+        level++;
+    return level;
+}
+
+// Free the skip index; the list itself is not touched
+void drop_skip_index(List* p_list) {
+    SkipIndex* index = p_list->skip_index;
+    if (index == NULL) return;
+    SkipNode* next;
+    for (SkipNode* node = index->header; node != NULL; node = next) {
+        next = node->forward[0];
+        free(node);
+    }
+    free(index);
+    p_list->skip_index = NULL;
+}
+
+// Build a skip index over the list, which must be sorted by compare_data.
+// It is used by insert_in_order() and pop_front() and dropped by the
+// operations that do not keep the order
+void enable_skip_index(List* p_list) {
+    drop_skip_index(p_list);
+    SkipIndex* index = safe_malloc(sizeof(SkipIndex));
+    SkipNode* last[SKIP_MAX_LEVEL];
+    index->compare = p_list->compare_data;
+    index->level = 1;
+    index->header = create_skip_node(NULL, SKIP_MAX_LEVEL);
+    for (int i = 0; i < SKIP_MAX_LEVEL; i++)
+        last[i] = index->header;
+    for (ListElement* ptr = p_list->head; ptr != NULL; ptr = ptr->next) {
+        SkipNode* node = create_skip_node(ptr, random_level());
+        for (int i = 0; i < node->level; i++) {
+            last[i]->forward[i] = node;
+            last[i] = node;
+        }
+        if (node->level > index->level) index->level = node->level;
+    }
+    p_list->skip_index = index;
+}
+
+// Fill update[] with the last node before data on every level.
+// Returns the node holding data (by compare), NULL if there is none
+SkipNode* skip_search(const SkipIndex* index, const void* data, SkipNode* update[]) {
+    SkipNode* node = index->header;
+    for (int i = index->level - 1; i >= 0; i--) {
+        while (node->forward[i] != NULL && index->compare(node->forward[i]->element->data, data) < 0)
+            node = node->forward[i];
+        update[i] = node;
+    }
+    node = node->forward[0];
+    if (node != NULL && !index->compare(node->element->data, data))
+        return node;
+    return NULL;
+}
+
+// --- hash index: O(1) duplicate detection
+
+// Free the hash index; the list itself is not touched
+void drop_hash_index(List* p_list) {
+    HashIndex* index = p_list->hash_index;
+    if (index == NULL) return;
+    free(index->slots);
+    free(index);
+    p_list->hash_index = NULL;
+}
+
+// Allocate slot_count free slots
+void hash_reset(HashIndex* index, size_t slot_count) {
+    index->slot_count = slot_count;
+    index->slots = safe_malloc(slot_count * sizeof(HashSlot));
+    for (size_t i = 0; i < slot_count; i++)
+        index->slots[i].element = NULL;
+}
+
+// Put element in the first free slot from its home slot on
+void hash_place(HashIndex* index, ListElement* element, size_t hash) {
+    size_t mask = index->slot_count - 1, i = hash & mask;
+    while (index->slots[i].element != NULL)
+        i = (i + 1) & mask;
+    index->slots[i].element = element;
+    index->slots[i].hash = hash;
+}
+
+// Double the slot array when it becomes half full
+void hash_grow(HashIndex* index) {
+    HashSlot* slots = index->slots;
+    size_t slot_count = index->slot_count;
+    hash_reset(index, 2 * slot_count);
+    for (size_t i = 0; i < slot_count; i++)
+        if (slots[i].element != NULL)
+            hash_place(index, slots[i].element, slots[i].hash);
+    free(slots);
+}
+
+void hash_add(HashIndex* index, ListElement* element) {
+    if (2 * (index->size + 1) > index->slot_count) hash_grow(index);
+    hash_place(index, element, index->hash(element->data));
+    index->size++;
+}
+
+// Remove the slot of element (found by identity, not by compare); the
+// elements probed after it move back so that no search stops early
+void hash_remove(HashIndex* index, const ListElement* element) {
+    size_t mask = index->slot_count - 1, i = index->hash(element->data) & mask;
+    while (index->slots[i].element != NULL && index->slots[i].element != element)
+        i = (i + 1) & mask;
+    if (index->slots[i].element == NULL) return;
+    for (size_t j = (i + 1) & mask; index->slots[j].element != NULL; j = (j + 1) & mask) {
+        size_t home = index->slots[j].hash & mask;
+        if (((j - home) & mask) >= ((j - i) & mask)) { // home not after the free slot i
+            index->slots[i] = index->slots[j];
+            i = j;
+        }
+    }
+    index->slots[i].element = NULL;
+    index->size--;
+}
+
+// Returns an element equal to data by compare, NULL if there is none
+ListElement* hash_find(const HashIndex* index, const void* data) {
+    size_t hash = index->hash(data), mask = index->slot_count - 1;
+    for (size_t i = hash & mask; index->slots[i].element != NULL; i = (i + 1) & mask)
+        if (index->slots[i].hash == hash && !index->compare(index->slots[i].element->data, data))
+            return index->slots[i].element;
+    return NULL;
+}
+
+// Build a hash index over the list using hash, which must agree with compare_data.
+// insert_in_order() and push_back_unique() then find duplicates in O(1);
+// every operation keeps it up to date
+void enable_hash_index(List* p_list, HashDataFp hash) {
+    drop_hash_index(p_list);
+    HashIndex* index = safe_malloc(sizeof(HashIndex));
+    index->hash = hash;
+    index->compare = p_list->compare_data;
+    index->size = 0;
+    hash_reset(index, HASH_MIN_SLOTS);
+    for (ListElement* ptr = p_list->head; ptr != NULL; ptr = ptr->next)
+        hash_add(index, ptr);
+    p_list->hash_index = index;
 }
 
 // Print elements of the list
@@ -70,18 +338,21 @@ void dump_list_if(List* p_list, void* data) {
 }
 
 // Free element pointed by data using free_data() function
-void free_element(DataFp free_data, ListElement* to_delete) {
-    if (free_data != NULL)
-        free_data(to_delete->data);
-    free(to_delete);
+void free_element(const List* p_list, ListElement* to_delete) {
+    if (p_list->free_data != NULL)
+        p_list->free_data(to_delete->data);
+    if (!p_list->intrusive)
+        free(to_delete);
 }
 
 // Free all elements of the list
 void free_list(List* p_list) {
+    drop_skip_index(p_list);
+    drop_hash_index(p_list);
     ListElement* next_ptr;
     for (ListElement* ptr = p_list->head; ptr != NULL; ptr = next_ptr) {
         next_ptr = ptr->next;
-        free_element(p_list->free_data, ptr);
+        free_element(p_list, ptr);
     }
     p_list->head = NULL;
     p_list->tail = NULL;
@@ -100,35 +371,48 @@ bool already_there(List* p_list, void* data) {
 // Push element at the beginning of the list
 void push_front(List* p_list, void* data) {
     //if (already_there(p_list, data)) return;
-    ListElement* new = safe_malloc(sizeof(ListElement));
+    drop_skip_index(p_list);
+    ListElement* new = create_element(p_list, data);
     new->next = p_list->head;
-    new->data = data;
     if (p_list->head == NULL)
         p_list->tail = new;
     p_list->head = new;
+    if (p_list->hash_index != NULL) hash_add(p_list->hash_index, new);
 }
 
 // Push element at the end of the list
 void push_back(List* p_list, void* data) {
     //if (already_there(p_list, data)) return;
-    ListElement* new = safe_malloc(sizeof(ListElement));
+    drop_skip_index(p_list);
+    ListElement* new = create_element(p_list, data);
     new->next = NULL;
-    new->data = data;
     if (p_list->head == NULL)
         p_list->head = new;
     else
         p_list->tail->next = new;
     p_list->tail = new;
+    if (p_list->hash_index != NULL) hash_add(p_list->hash_index, new);
 }
 
 // Remove the first element
 void pop_front(List* p_list) {
-    free_element(p_list->free_data, p_list->head);
-    p_list->head = p_list->head->next;
+    ListElement* head = p_list->head;
+    SkipIndex* index = p_list->skip_index;
+    if (index != NULL) {
+        SkipNode* first = index->header->forward[0];
+        for (int i = 0; i < first->level; i++)
+            index->header->forward[i] = first->forward[i];
+        free(first);
+    }
+    if (p_list->hash_index != NULL) hash_remove(p_list->hash_index, head);
+    p_list->head = head->next;
+    if (p_list->head == NULL) p_list->tail = NULL;
+    free_element(p_list, head);
 }
 
 // Reverse the list
 void reverse(List* p_list) {
+    drop_skip_index(p_list);
     ListElement* ptr = p_list->head;
     ListElement* first = ptr->next;
     ListElement* second = ptr->next;
@@ -144,34 +428,468 @@ void reverse(List* p_list) {
     p_list->tail = tmp;
 }
 
-// find element in sorted list after which to insert given element
-ListElement* find_insertion_point(const List* p_list, ListElement* p_element) {
+// find element in sorted list after which to insert given data
+ListElement* find_insertion_point(const List* p_list, const void* data) {
     if (p_list->head == NULL) return NULL; // Pusta lista
-    if (p_list->compare_data(p_list->head->data, p_element->data) > 0) return NULL; // Na początek
+    if (p_list->compare_data(p_list->head->data, data) > 0) return NULL; // Na początek
     for (ListElement* ptr = p_list->head; ptr != p_list->tail; ptr = ptr->next)
-        if (p_list->compare_data(ptr->next->data, p_element->data) > 0)
+        if (p_list->compare_data(ptr->next->data, data) > 0)
             return ptr; // Gdzieś w środku
     return p_list->tail; // Na koniec
 }
 
 // Insert element after 'previous'
 void push_after(List* p_list, void* data, ListElement* previous) {
-    if (previous == NULL) push_front(p_list, data);
-    else {
-        ListElement* new = safe_malloc(sizeof(ListElement));
+    ListElement* new = create_element(p_list, data);
+    if (previous == NULL) {
+        new->next = p_list->head;
+        if (p_list->head == NULL) p_list->tail = new;
+        p_list->head = new;
+    } else {
         new->next = previous->next;
-        new->data = data;
         previous->next = new;
+        if (previous == p_list->tail) p_list->tail = new;
     }
+    if (p_list->hash_index != NULL) hash_add(p_list->hash_index, new);
 }
 
-// Insert element preserving order
-void insert_in_order(List* p_list, void* p_data) {
-    if (already_there(p_list, p_data)) return;
-    ListElement* new = safe_malloc(sizeof(ListElement));
-    new->next = NULL;
-    new->data = p_data;
-    push_after(p_list, p_data, find_insertion_point(p_list, new));
+// Insert element preserving order using the skip index:
+// one O(log n) search both finds a duplicate and the insertion point
+bool skip_insert_in_order(List* p_list, void* p_data) {
+    SkipIndex* index = p_list->skip_index;
+    SkipNode* update[SKIP_MAX_LEVEL];
+    SkipNode* found = skip_search(index, p_data, update);
+    if (found != NULL) {
+        if (p_list->modify_data != NULL)
+            p_list->modify_data(found->element->data);
+        return false;
+    }
+    ListElement* previous = update[0]->element;
+    push_after(p_list, p_data, previous);
+    SkipNode* node = create_skip_node(previous == NULL ? p_list->head : previous->next, random_level());
+    for (int i = index->level; i < node->level; i++)
+        update[i] = index->header;
+    if (node->level > index->level) index->level = node->level;
+    for (int i = 0; i < node->level; i++) {
+        node->forward[i] = update[i]->forward[i];
+        update[i]->forward[i] = node;
+    }
+    return true;
+}
+
+// Insert element preserving order. Returns false if an equal element was
+// already there: modify_data is called on it and p_data is not linked
+bool insert_in_order(List* p_list, void* p_data) {
+    if (p_list->skip_index != NULL && p_list->skip_index->compare != p_list->compare_data)
+        drop_skip_index(p_list);
+    if (p_list->hash_index != NULL && p_list->hash_index->compare != p_list->compare_data)
+        drop_hash_index(p_list);
+    if (p_list->hash_index != NULL) {
+        ListElement* found = hash_find(p_list->hash_index, p_data);
+        if (found != NULL) {
+            if (p_list->modify_data != NULL)
+                p_list->modify_data(found->data);
+            return false;
+        }
+    }
+    if (p_list->skip_index != NULL)
+        return skip_insert_in_order(p_list, p_data);
+    if (already_there(p_list, p_data)) return false;
+    push_after(p_list, p_data, find_insertion_point(p_list, p_data));
+    return true;
+}
+
+// Push element at the end unless an equal element is already there (found in
+// O(1) with a hash index): then modify_data is called on it and false is
+// returned, as by insert_in_order(). A list filled so and sorted once by
+// sort_list() is the one insert_in_order() builds, with no skip nodes
+bool push_back_unique(List* p_list, void* p_data) {
+    if (p_list->hash_index != NULL && p_list->hash_index->compare != p_list->compare_data)
+        drop_hash_index(p_list);
+    if (p_list->hash_index != NULL) {
+        ListElement* found = hash_find(p_list->hash_index, p_data);
+        if (found != NULL) {
+            if (p_list->modify_data != NULL)
+                p_list->modify_data(found->data);
+            return false;
+        }
+    } else if (already_there(p_list, p_data)) return false;
+    push_back(p_list, p_data);
+    return true;
+}
+
+// Sort the list by compare_data: stable, in place, bottom-up merge sort
+// (runs of width 1, 2, 4, ... are merged pairwise by relinking)
+void sort_list(List* p_list) {
+    drop_skip_index(p_list);
+    if (p_list->head == NULL) return;
+    ListElement* list = p_list->head;
+    for (size_t width = 1;; width *= 2) {
+        ListElement* left = list, * right, * tail = NULL, * next;
+        size_t merges = 0;
+        list = NULL;
+        while (left != NULL) {
+            size_t left_size = 0, right_size = width;
+            merges++;
+            for (right = left; right != NULL && left_size < width; right = right->next)
+                left_size++;
+            while (left_size > 0 || (right_size > 0 && right != NULL)) {
+                if (left_size == 0 || (right_size > 0 && right != NULL &&
+                                       p_list->compare_data(left->data, right->data) > 0)) {
+                    next = right;
+                    right = right->next;
+                    right_size--;
+                } else {
+                    next = left;
+                    left = left->next;
+                    left_size--;
+                }
+                if (tail == NULL) list = next;
+                else tail->next = next;
+                tail = next;
+            }
+            left = right;
+        }
+        tail->next = NULL;
+        if (merges <= 1) {
+            p_list->head = list;
+            p_list->tail = tail;
+            return;
+        }
+    }
+}
+
+// Fold every run of elements equal by compare_data into its first element:
+// modify_data is called on it once per later element, which is freed
+void unique_list(List* p_list) {
+    drop_skip_index(p_list);
+    ListElement* ptr = p_list->head;
+    while (ptr != NULL && ptr->next != NULL) {
+        ListElement* next = ptr->next;
+        if (p_list->compare_data(ptr->data, next->data)) {
+            ptr = next;
+            continue;
+        }
+        if (p_list->modify_data != NULL)
+            p_list->modify_data(ptr->data);
+        ptr->next = next->next;
+        if (next == p_list->tail) p_list->tail = ptr;
+        if (p_list->hash_index != NULL) hash_remove(p_list->hash_index, next);
+        free_element(p_list, next);
+    }
+}
+
+// --- unrolled list: same operations on nodes holding UNROLL_CAPACITY data pointers
+
+void init_unrolled(UnrolledList* p_list, ConstDataFp dump_data, DataFp free_data,
+                   CompareDataFp compare_data, DataFp modify_data) {
+    p_list->head = NULL;
+    p_list->tail = NULL;
+    p_list->dump_data = dump_data;
+    p_list->free_data = free_data;
+    p_list->compare_data = compare_data;
+    p_list->modify_data = modify_data;
+}
+
+UnrolledNode* create_unrolled_node(UnrolledNode* next, int first) {
+    UnrolledNode* node = safe_malloc(sizeof(UnrolledNode));
+    node->next = next;
+    node->first = first;
+    node->count = 0;
+    return node;
+}
+
+// Print elements of the list
+void dump_unrolled(const UnrolledList* p_list) {
+    for (UnrolledNode* node = p_list->head; node != NULL; node = node->next)
+        for (int i = node->first; i < node->first + node->count; i++)
+            p_list->dump_data(node->data[i]);
+    printf("\n");
+}
+
+// Free all elements of the list
+void free_unrolled(UnrolledList* p_list) {
+    UnrolledNode* next;
+    for (UnrolledNode* node = p_list->head; node != NULL; node = next) {
+        next = node->next;
+        if (p_list->free_data != NULL)
+            for (int i = node->first; i < node->first + node->count; i++)
+                p_list->free_data(node->data[i]);
+        free(node);
+    }
+    p_list->head = NULL;
+    p_list->tail = NULL;
+}
+
+// Push element at the beginning of the list
+void unrolled_push_front(UnrolledList* p_list, void* data) {
+    UnrolledNode* node = p_list->head;
+    if (node == NULL || node->first == 0) {
+        node = create_unrolled_node(p_list->head, UNROLL_CAPACITY);
+        if (p_list->head == NULL) p_list->tail = node;
+        p_list->head = node;
+    }
+    node->data[--node->first] = data;
+    node->count++;
+}
+
+// Push element at the end of the list
+void unrolled_push_back(UnrolledList* p_list, void* data) {
+    UnrolledNode* node = p_list->tail;
+    if (node == NULL || node->first + node->count == UNROLL_CAPACITY) {
+        node = create_unrolled_node(NULL, 0);
+        if (p_list->tail == NULL) p_list->head = node;
+        else p_list->tail->next = node;
+        p_list->tail = node;
+    }
+    node->data[node->first + node->count++] = data;
+}
+
+// Remove the first element
+void unrolled_pop_front(UnrolledList* p_list) {
+    UnrolledNode* node = p_list->head;
+    if (p_list->free_data != NULL)
+        p_list->free_data(node->data[node->first]);
+    node->first++;
+    if (--node->count > 0) return;
+    p_list->head = node->next;
+    if (p_list->head == NULL) p_list->tail = NULL;
+    free(node);
+}
+
+// Reverse the list: the node order and the data within every node
+void unrolled_reverse(UnrolledList* p_list) {
+    UnrolledNode* previous = NULL, * next;
+    p_list->tail = p_list->head;
+    for (UnrolledNode* node = p_list->head; node != NULL; node = next) {
+        next = node->next;
+        node->next = previous;
+        previous = node;
+        for (int i = node->first, j = node->first + node->count - 1; i < j; i++, j--) {
+            void* tmp = node->data[i];
+            node->data[i] = node->data[j];
+            node->data[j] = tmp;
+        }
+    }
+    p_list->head = previous;
+}
+
+// Insert data at position index of node (first <= index <= first + count),
+// splitting the node in two halves first if it is full
+void unrolled_insert_at(UnrolledList* p_list, UnrolledNode* node, int index, void* data) {
+    if (node->count == UNROLL_CAPACITY) {
+        UnrolledNode* half = create_unrolled_node(node->next, 0);
+        half->count = UNROLL_CAPACITY / 2;
+        memcpy(half->data, node->data + UNROLL_CAPACITY / 2, sizeof(void*) * half->count);
+        node->next = half;
+        node->count -= half->count;
+        if (p_list->tail == node) p_list->tail = half;
+        if (index > UNROLL_CAPACITY / 2) {
+            node = half;
+            index -= UNROLL_CAPACITY / 2;
+        }
+    }
+    int end = node->first + node->count;
+    if (end == UNROLL_CAPACITY) { // no room after the elements: move them to the front
+        memmove(node->data, node->data + node->first, sizeof(void*) * node->count);
+        index -= node->first;
+        end -= node->first;
+        node->first = 0;
+    }
+    memmove(node->data + index + 1, node->data + index, sizeof(void*) * (end - index));
+    node->data[index] = data;
+    node->count++;
+}
+
+// Insert element preserving order: one pass over the arrays finds both a
+// duplicate and the first greater element. Returns false if an equal element
+// was already there: modify_data is called on it and p_data is not stored
+bool unrolled_insert_in_order(UnrolledList* p_list, void* p_data) {
+    UnrolledNode* target = NULL;
+    int index = 0;
+    for (UnrolledNode* node = p_list->head; node != NULL; node = node->next)
+        for (int i = node->first; i < node->first + node->count; i++) {
+            int order = p_list->compare_data(node->data[i], p_data);
+            if (order == 0) {
+                if (p_list->modify_data != NULL)
+                    p_list->modify_data(node->data[i]);
+                return false;
+            }
+            if (order > 0 && target == NULL) {
+                target = node;
+                index = i;
+            }
+        }
+    if (target == NULL) unrolled_push_back(p_list, p_data);
+    else if (target == p_list->head && index == target->first && target->first > 0) {
+        target->data[--target->first] = p_data;
+        target->count++;
+    } else unrolled_insert_at(p_list, target, index, p_data);
+    return true;
+}
+
+// --- queue list: multi-producer single-consumer queue (Vyukov)
+
+void init_queue(QueueList* p_queue, DataFp free_data) {
+    QueueNode* dummy = safe_malloc(sizeof(QueueNode));
+    atomic_init(&dummy->next, NULL);
+    dummy->data = NULL;
+    atomic_init(&p_queue->tail, dummy);
+    p_queue->head = dummy;
+    p_queue->free_data = free_data;
+}
+
+// Push element at the end of the queue: one atomic exchange, never waits
+void queue_push_back(QueueList* p_queue, void* data) {
+    QueueNode* new = safe_malloc(sizeof(QueueNode));
+    atomic_init(&new->next, NULL);
+    new->data = data;
+    QueueNode* previous = atomic_exchange_explicit(&p_queue->tail, new, memory_order_acq_rel);
+    atomic_store_explicit(&previous->next, new, memory_order_release);
+}
+
+// Remove the first element and return its data, NULL if the queue is empty
+// (or a producer has not finished linking its element yet)
+void* queue_pop_front(QueueList* p_queue) {
+    QueueNode* dummy = p_queue->head;
+    QueueNode* first = atomic_load_explicit(&dummy->next, memory_order_acquire);
+    if (first == NULL) return NULL;
+    void* data = first->data;
+    first->data = NULL;
+    p_queue->head = first; // first becomes the dummy
+    free(dummy);
+    return data;
+}
+
+// Free all elements of the queue; no thread may be using it
+void free_queue(QueueList* p_queue) {
+    void* data;
+    while ((data = queue_pop_front(p_queue)) != NULL)
+        if (p_queue->free_data != NULL)
+            p_queue->free_data(data);
+    free(p_queue->head);
+    p_queue->head = NULL;
+}
+
+// --- pool list: elements in two growable arrays, linked by 32-bit indices
+
+void init_pool_list(PoolList* p_list, ConstDataFp dump_data, DataFp free_data,
+                    CompareDataFp compare_data, DataFp modify_data) {
+    p_list->data = NULL;
+    p_list->next = NULL;
+    p_list->capacity = 0;
+    p_list->used = 0;
+    p_list->head = POOL_NIL;
+    p_list->tail = POOL_NIL;
+    p_list->free_head = POOL_NIL;
+    p_list->dump_data = dump_data;
+    p_list->free_data = free_data;
+    p_list->compare_data = compare_data;
+    p_list->modify_data = modify_data;
+}
+
+// Take a slot from the free list, or the next unused one (the pool doubles when full)
+uint32_t pool_take(PoolList* p_list, void* data) {
+    uint32_t slot = p_list->free_head;
+    if (slot != POOL_NIL) p_list->free_head = p_list->next[slot];
+    else {
+        if (p_list->used == p_list->capacity) {
+            if (p_list->capacity == POOL_NIL / 2 + 1) {
+                printf("pool full\n");
+                exit(EXIT_FAILURE);
+            }
+            p_list->capacity = p_list->capacity == 0 ? 16 : p_list->capacity * 2;
+            p_list->data = safe_realloc(p_list->data, p_list->capacity * sizeof(void*));
+            p_list->next = safe_realloc(p_list->next, p_list->capacity * sizeof(uint32_t));
+        }
+        slot = p_list->used++;
+    }
+    p_list->data[slot] = data;
+    return slot;
+}
+
+// Print elements of the list
+void dump_pool_list(const PoolList* p_list) {
+    for (uint32_t i = p_list->head; i != POOL_NIL; i = p_list->next[i])
+        p_list->dump_data(p_list->data[i]);
+    printf("\n");
+}
+
+// Free all elements of the list: the pool goes away in one piece
+void free_pool_list(PoolList* p_list) {
+    if (p_list->free_data != NULL)
+        for (uint32_t i = p_list->head; i != POOL_NIL; i = p_list->next[i])
+            p_list->free_data(p_list->data[i]);
+    free(p_list->data);
+    free(p_list->next);
+    init_pool_list(p_list, p_list->dump_data, p_list->free_data, p_list->compare_data, p_list->modify_data);
+}
+
+// Push element at the beginning of the list
+void pool_push_front(PoolList* p_list, void* data) {
+    uint32_t slot = pool_take(p_list, data);
+    p_list->next[slot] = p_list->head;
+    if (p_list->head == POOL_NIL) p_list->tail = slot;
+    p_list->head = slot;
+}
+
+// Push element at the end of the list
+void pool_push_back(PoolList* p_list, void* data) {
+    uint32_t slot = pool_take(p_list, data);
+    p_list->next[slot] = POOL_NIL;
+    if (p_list->head == POOL_NIL) p_list->head = slot;
+    else p_list->next[p_list->tail] = slot;
+    p_list->tail = slot;
+}
+
+// Remove the first element, its slot is reused by the next push
+void pool_pop_front(PoolList* p_list) {
+    uint32_t slot = p_list->head;
+    if (p_list->free_data != NULL)
+        p_list->free_data(p_list->data[slot]);
+    p_list->head = p_list->next[slot];
+    if (p_list->head == POOL_NIL) p_list->tail = POOL_NIL;
+    p_list->next[slot] = p_list->free_head;
+    p_list->free_head = slot;
+}
+
+// Reverse the list
+void pool_reverse(PoolList* p_list) {
+    uint32_t previous = POOL_NIL, next;
+    p_list->tail = p_list->head;
+    for (uint32_t i = p_list->head; i != POOL_NIL; i = next) {
+        next = p_list->next[i];
+        p_list->next[i] = previous;
+        previous = i;
+    }
+    p_list->head = previous;
+}
+
+// Insert element preserving order: one pass finds both a duplicate and the
+// first greater element. Returns false if an equal element was already
+// there: modify_data is called on it and data is not linked
+bool pool_insert_in_order(PoolList* p_list, void* data) {
+    uint32_t previous = POOL_NIL;
+    bool found_greater = false;
+    for (uint32_t i = p_list->head; i != POOL_NIL; i = p_list->next[i]) {
+        int order = p_list->compare_data(p_list->data[i], data);
+        if (order == 0) {
+            if (p_list->modify_data != NULL)
+                p_list->modify_data(p_list->data[i]);
+            return false;
+        }
+        if (order > 0) found_greater = true;
+        if (!found_greater) previous = i;
+    }
+    if (previous == POOL_NIL) {
+        pool_push_front(p_list, data);
+        return true;
+    }
+    uint32_t slot = pool_take(p_list, data);
+    p_list->next[slot] = p_list->next[previous];
+    p_list->next[previous] = slot;
+    if (previous == p_list->tail) p_list->tail = slot;
+    return true;
 }
 
 // -----------------------------------------------------------
@@ -202,10 +920,166 @@ int* create_data_int(int v) {
 // Word element
 
 typedef struct DataWord {
-    char* word;
+    ListElement link; // used by intrusive lists only
+    struct FreqEntry* entry; // right in front of the word, NULL if not counted
     int counter;
+    char word[];
 } DataWord;
 
+// word in a FrequencyIndex; allocated together with a counted word
+// (create_counted_word()), so that uncounted words stay small
+typedef struct FreqEntry {
+    DataWord* word;
+    struct FreqBucket* bucket;
+    struct FreqEntry* prev; // neighbours in the bucket
+    struct FreqEntry* next;
+} FreqEntry;
+
+// words with the same counter; buckets form a ring ordered by count
+typedef struct FreqBucket {
+    int count;
+    struct FreqBucket* prev;
+    struct FreqBucket* next;
+    FreqEntry* entries;
+    struct FrequencyIndex* index;
+} FreqBucket;
+
+// LFU-style index of words by counter, kept up to date by modify_word()
+typedef struct FrequencyIndex {
+    FreqBucket ring; // sentinel: ring.next has the lowest count, ring.prev the highest
+    FreqBucket** by_count; // bucket of every count below capacity, or NULL
+    int capacity;
+} FrequencyIndex;
+
+void init_frequency_index(FrequencyIndex* index) {
+    index->ring.count = 0;
+    index->ring.prev = &index->ring;
+    index->ring.next = &index->ring;
+    index->ring.entries = NULL;
+    index->ring.index = index;
+    index->by_count = NULL;
+    index->capacity = 0;
+}
+
+// Create the bucket for count right after 'previous'
+FreqBucket* create_bucket(FrequencyIndex* index, int count, FreqBucket* previous) {
+    if (count >= index->capacity) {
+        int capacity = index->capacity == 0 ? 16 : index->capacity;
+        while (capacity <= count) capacity *= 2;
+        FreqBucket** by_count = safe_realloc(index->by_count, capacity * sizeof(FreqBucket*));
+        for (int i = index->capacity; i < capacity; i++)
+            by_count[i] = NULL;
+        index->by_count = by_count;
+        index->capacity = capacity;
+    }
+    FreqBucket* bucket = safe_malloc(sizeof(FreqBucket));
+    bucket->count = count;
+    bucket->entries = NULL;
+    bucket->index = index;
+    bucket->prev = previous;
+    bucket->next = previous->next;
+    previous->next->prev = bucket;
+    previous->next = bucket;
+    index->by_count[count] = bucket;
+    return bucket;
+}
+
+void bucket_link(FreqBucket* bucket, FreqEntry* entry) {
+    entry->bucket = bucket;
+    entry->prev = NULL;
+    entry->next = bucket->entries;
+    if (bucket->entries != NULL) bucket->entries->prev = entry;
+    bucket->entries = entry;
+}
+
+// Unlink entry from its bucket, freeing the bucket when it becomes empty
+void bucket_unlink(FreqEntry* entry) {
+    FreqBucket* bucket = entry->bucket;
+    if (entry->prev != NULL) entry->prev->next = entry->next;
+    else bucket->entries = entry->next;
+    if (entry->next != NULL) entry->next->prev = entry->prev;
+    entry->bucket = NULL;
+    if (bucket->entries != NULL) return;
+    bucket->prev->next = bucket->next;
+    bucket->next->prev = bucket->prev;
+    bucket->index->by_count[bucket->count] = NULL;
+    free(bucket);
+}
+
+// Add word, made by create_counted_word(), to the bucket of its counter
+void frequency_add(FrequencyIndex* index, DataWord* word) {
+    FreqBucket* bucket = word->counter < index->capacity ? index->by_count[word->counter] : NULL;
+    if (bucket == NULL) {
+        FreqBucket* previous = &index->ring;
+        while (previous->next != &index->ring && previous->next->count < word->counter)
+            previous = previous->next;
+        bucket = create_bucket(index, word->counter, previous);
+    }
+    bucket_link(bucket, word->entry);
+}
+
+// Detach all words and free the buckets; the words themselves are not touched
+void free_frequency_index(FrequencyIndex* index) {
+    while (index->ring.next != &index->ring) {
+        FreqBucket* bucket = index->ring.next;
+        while (bucket->entries != NULL) {
+            bucket->entries->bucket = NULL;
+            bucket->entries = bucket->entries->next;
+        }
+        index->ring.next = bucket->next;
+        free(bucket);
+    }
+    index->ring.prev = &index->ring;
+    free(index->by_count);
+    index->by_count = NULL;
+    index->capacity = 0;
+}
+
+// Stable merge sort of n pointers by cmp on the pointed data; buffer holds n pointers
+void sort_pointers(void** items, void** buffer, size_t n, CompareDataFp cmp) {
+    if (n < 2) return;
+    size_t half = n / 2;
+    sort_pointers(items, buffer, half, cmp);
+    sort_pointers(items + half, buffer, n - half, cmp);
+    memcpy(buffer, items, half * sizeof(void*));
+    size_t i = 0, j = half, k = 0;
+    while (i < half && j < n)
+        items[k++] = cmp(buffer[i], items[j]) <= 0 ? buffer[i++] : items[j++];
+    while (i < half)
+        items[k++] = buffer[i++];
+}
+
+// Print the words seen exactly count times, ordered by cmp if not NULL
+void dump_count_equal(const FrequencyIndex* index, int count, ConstDataFp dump_data, CompareDataFp cmp) {
+    FreqBucket* bucket = count >= 0 && count < index->capacity ? index->by_count[count] : NULL;
+    size_t size = 0;
+    for (FreqEntry* entry = bucket != NULL ? bucket->entries : NULL; entry != NULL; entry = entry->next)
+        size++;
+    if (size > 0) {
+        DataWord** words = safe_malloc(size * sizeof(DataWord*));
+        size = 0;
+        for (FreqEntry* entry = bucket->entries; entry != NULL; entry = entry->next)
+            words[size++] = entry->word;
+        if (cmp != NULL) {
+            DataWord** buffer = safe_malloc(size * sizeof(DataWord*));
+            sort_pointers((void**) words, (void**) buffer, size, cmp);
+            free(buffer);
+        }
+        for (size_t i = 0; i < size; i++)
+            dump_data(words[i]);
+        free(words);
+    }
+    printf("\n");
+}
+
+// Print (up to) k words with the highest counters, most frequent first
+void dump_most_frequent(const FrequencyIndex* index, int k, ConstDataFp dump_data) {
+    for (FreqBucket* bucket = index->ring.prev; bucket != &index->ring && k > 0; bucket = bucket->prev)
+        for (FreqEntry* entry = bucket->entries; entry != NULL && k > 0; entry = entry->next, k--)
+            dump_data(entry->word);
+    printf("\n");
+}
+
 void dump_word(const void* d) {
     printf("%s ", ((DataWord*) d)->word);
 }
@@ -218,8 +1092,13 @@ void dump_word_lowercase(const void* d) {
 }
 
 void free_word(void* d) {
-    free(((DataWord*) d)->word);
-    free(d);
+    FreqEntry* entry = ((DataWord*) d)->entry;
+    if (entry == NULL) {
+        free(d);
+        return;
+    }
+    if (entry->bucket != NULL) bucket_unlink(entry);
+    free(entry); // the block of the word
 }
 
 int cmp_word_alphabet(const void* a, const void* b) {
@@ -230,14 +1109,48 @@ int cmp_word_counter(const void* a, const void* b) {
     return cmp_int(&((DataWord*) a)->counter, &((DataWord*) b)->counter);
 }
 
+// FNV-1a hash of the lowercase word, agrees with cmp_word_alphabet
+size_t hash_word_folded(const void* d) {
+    size_t hash = 14695981039346656037u;
+    for (const char* c = ((DataWord*) d)->word; *c != '\0'; c++) {
+        hash ^= (unsigned char) tolower((unsigned char) *c);
+        hash *= 1099511628211u;
+    }
+    return hash;
+}
+
+// Count the word once more, moving it to the next bucket if it is indexed
 void modify_word(void* p) {
-    ((DataWord*) p)->counter++;
+    DataWord* word = p;
+    word->counter++;
+    if (word->entry == NULL || word->entry->bucket == NULL) return;
+    FreqBucket* bucket = word->entry->bucket;
+    FreqBucket* next = bucket->next;
+    if (next == &bucket->index->ring || next->count != word->counter)
+        next = create_bucket(bucket->index, word->counter, bucket);
+    bucket_unlink(word->entry);
+    bucket_link(next, word->entry);
 }
 
 void* create_data_word(const char* string, int counter) {
-    DataWord* ptr = safe_malloc(sizeof(DataWord));
-    ptr->word = safe_strdup(string);
+    size_t length = strlen(string);
+    DataWord* ptr = safe_malloc(sizeof(DataWord) + length + 1);
+    memcpy(ptr->word, string, length + 1);
     ptr->counter = counter; // Po co ten parametr? Nie można zawsze 1?
+    ptr->entry = NULL;
+    return ptr;
+}
+
+// word with room for its FreqEntry in the same block, for frequency_add()
+void* create_counted_word(const char* string, int counter) {
+    size_t length = strlen(string);
+    FreqEntry* entry = safe_malloc(sizeof(FreqEntry) + sizeof(DataWord) + length + 1);
+    DataWord* ptr = (DataWord*) (entry + 1);
+    memcpy(ptr->word, string, length + 1);
+    ptr->counter = counter;
+    ptr->entry = entry;
+    entry->word = ptr;
+    entry->bucket = NULL;
     return ptr;
 }
 
@@ -245,44 +1158,134 @@ void* create_data_word(const char* string, int counter) {
 // Order of insertions is given by the last parameter of type CompareDataFp.
 // (comparator function address). If this address is not NULL the element is
 // inserted according to the comparator. Otherwise, read order is preserved.
-void stream_to_list(List* p_list, FILE* stream, CompareDataFp cmp) {
+// With hash (agreeing with cmp) a hash index finds the duplicates and the list
+// is sorted once at the end, NULL means a skip index keeps it in order.
+// Words are also added to counts unless it is NULL.
+void stream_to_list(List* p_list, FILE* stream, CompareDataFp cmp, HashDataFp hash, FrequencyIndex* counts) {
     char buff[BUFFER_SIZE] = {0};
     char delim[] = " \n\t\r\v\f.,?!:;-";
     p_list->compare_data = cmp;
+    if (cmp != NULL && hash != NULL) enable_hash_index(p_list, hash);
+    else if (cmp != NULL) enable_skip_index(p_list);
     while (fgets(buff, BUFFER_SIZE, stream) != NULL) {
         for (char* str = strtok(buff, delim); str != NULL; str = strtok(NULL, delim)) {
             if (strlen(str) == 0) continue;
-            DataWord* data = create_data_word(str, 1);
+            DataWord* data = counts != NULL ? create_counted_word(str, 1) : create_data_word(str, 1);
             if (cmp == NULL) push_back(p_list, data);
-            else insert_in_order(p_list, data);
+            else if (hash != NULL ? !push_back_unique(p_list, data) : !insert_in_order(p_list, data)) {
+                free_word(data);
+                continue;
+            }
+            if (counts != NULL) frequency_add(counts, data);
         }
     }
+    if (cmp != NULL && hash != NULL) sort_list(p_list);
+}
+
+// operations of a list variant, for list_test()
+typedef struct ListOps {
+    void (* push_front)(void* p_list, void* data);
+    void (* push_back)(void* p_list, void* data);
+    void (* pop_front)(void* p_list);
+    void (* reverse)(void* p_list);
+    bool (* insert_in_order)(void* p_list, void* data);
+} ListOps;
+
+void list_push_front(void* p_list, void* data) {
+    push_front(p_list, data);
 }
 
-// test integer list
-void list_test(List* p_list, int n) {
+void list_push_back(void* p_list, void* data) {
+    push_back(p_list, data);
+}
+
+void list_pop_front(void* p_list) {
+    pop_front(p_list);
+}
+
+void list_reverse(void* p_list) {
+    reverse(p_list);
+}
+
+bool list_insert_in_order(void* p_list, void* data) {
+    return insert_in_order(p_list, data);
+}
+
+const ListOps list_ops = {list_push_front, list_push_back, list_pop_front,
+                          list_reverse, list_insert_in_order};
+
+void unrolled_push_front_op(void* p_list, void* data) {
+    unrolled_push_front(p_list, data);
+}
+
+void unrolled_push_back_op(void* p_list, void* data) {
+    unrolled_push_back(p_list, data);
+}
+
+void unrolled_pop_front_op(void* p_list) {
+    unrolled_pop_front(p_list);
+}
+
+void unrolled_reverse_op(void* p_list) {
+    unrolled_reverse(p_list);
+}
+
+bool unrolled_insert_in_order_op(void* p_list, void* data) {
+    return unrolled_insert_in_order(p_list, data);
+}
+
+const ListOps unrolled_ops = {unrolled_push_front_op, unrolled_push_back_op, unrolled_pop_front_op,
+                              unrolled_reverse_op, unrolled_insert_in_order_op};
+
+void pool_push_front_op(void* p_list, void* data) {
+    pool_push_front(p_list, data);
+}
+
+void pool_push_back_op(void* p_list, void* data) {
+    pool_push_back(p_list, data);
+}
+
+void pool_pop_front_op(void* p_list) {
+    pool_pop_front(p_list);
+}
+
+void pool_reverse_op(void* p_list) {
+    pool_reverse(p_list);
+}
+
+bool pool_insert_in_order_op(void* p_list, void* data) {
+    return pool_insert_in_order(p_list, data);
+}
+
+const ListOps pool_ops = {pool_push_front_op, pool_push_back_op, pool_pop_front_op,
+                          pool_reverse_op, pool_insert_in_order_op};
+
+// test integer list of any variant, through its operations
+void list_test(void* p_list, const ListOps* ops, int n) {
     char op;
     int v;
+    int* data;
     for (int i = 0; i < n; ++i) {
         scanf(" %c", &op);
         switch (op) {
             case 'f':
                 scanf("%d", &v);
-                push_front(p_list, create_data_int(v));
+                ops->push_front(p_list, create_data_int(v));
                 break;
             case 'b':
                 scanf("%d", &v);
-                push_back(p_list, create_data_int(v));
+                ops->push_back(p_list, create_data_int(v));
                 break;
             case 'd':
-                pop_front(p_list);
+                ops->pop_front(p_list);
                 break;
             case 'r':
-                reverse(p_list);
+                ops->reverse(p_list);
                 break;
             case 'i':
                 scanf("%d", &v);
-                insert_in_order(p_list, create_data_int(v));
+                data = create_data_int(v);
+                if (!ops->insert_in_order(p_list, data)) free_int(data);
                 break;
             default:
                 printf("No such operation: %c\n", op);
@@ -291,33 +1294,210 @@ void list_test(List* p_list, int n) {
     }
 }
 
+double seconds_since(clock_t start) {
+    return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+// wall-clock time, for benchmarks where several threads run
+double wall_seconds(void) {
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return (double) now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// pseudo-random lowercase word number id
+void make_word(char* buff, unsigned id) {
+    unsigned x = id * 2654435761u;
+    int length = 3 + (int) (x % 8);
+    for (int i = 0; i < length; i++) {
+        buff[i] = (char) ('a' + x % 26);
+        x = x / 26 + id * 40503u;
+    }
+    buff[length] = '\0';
+}
+
+// build the alphabetical word list of case 3 from n random words
+// with insert_in_order (skip index) and with push_back + sort_list
+void benchmark_sort(int n) {
+    List ordered, sorted;
+    char word[16];
+    void* data;
+    unsigned vocabulary = (unsigned) n / 10 + 1;
+    init_list(&ordered, dump_word, free_word, cmp_word_alphabet, modify_word);
+    init_list(&sorted, dump_word, free_word, cmp_word_alphabet, modify_word);
+    enable_skip_index(&ordered);
+    srand(1);
+    clock_t start = clock();
+    for (int i = 0; i < n; i++) {
+        make_word(word, (unsigned) rand() % vocabulary);
+        data = create_data_word(word, 1);
+        if (!insert_in_order(&ordered, data)) free_word(data);
+    }
+    double insert_time = seconds_since(start);
+    srand(1);
+    start = clock();
+    for (int i = 0; i < n; i++) {
+        make_word(word, (unsigned) rand() % vocabulary);
+        push_back(&sorted, create_data_word(word, 1));
+    }
+    sort_list(&sorted);
+    unique_list(&sorted);
+    double sort_time = seconds_since(start);
+    printf("%d words: insert_in_order %.3f s, push_back + sort_list %.3f s\n", n, insert_time, sort_time);
+    free_list(&ordered);
+    free_list(&sorted);
+}
+
+#define QUEUE_PRODUCERS 4
+
+// shared state of benchmark_queue: the queue under test and the items to push
+typedef struct {
+    QueueList* queue; // lock-free variant, or NULL
+    List* list; // mutex-wrapped List otherwise
+    pthread_mutex_t* mutex;
+    int* items;
+    int count;
+} QueueJob;
+
+void* produce(void* arg) {
+    QueueJob* job = arg;
+    for (int i = 0; i < job->count; i++) {
+        if (job->queue != NULL) queue_push_back(job->queue, &job->items[i]);
+        else {
+            pthread_mutex_lock(job->mutex);
+            push_back(job->list, &job->items[i]);
+            pthread_mutex_unlock(job->mutex);
+        }
+    }
+    return NULL;
+}
+
+// take the data of the first element of the mutex-wrapped list, NULL if empty
+void* locked_pop_front(List* p_list, pthread_mutex_t* mutex) {
+    void* data = NULL;
+    pthread_mutex_lock(mutex);
+    if (p_list->head != NULL) {
+        data = p_list->head->data;
+        pop_front(p_list);
+    }
+    pthread_mutex_unlock(mutex);
+    return data;
+}
+
+// QUEUE_PRODUCERS threads push n items each, the main thread pops and sums them;
+// returns the wall-clock time, the sum is checked
+double run_queue(QueueList* queue, List* list, pthread_mutex_t* mutex, int* items, int n) {
+    pthread_t threads[QUEUE_PRODUCERS];
+    QueueJob jobs[QUEUE_PRODUCERS];
+    long long sum = 0, expected = 0;
+    double start = wall_seconds();
+    for (int t = 0; t < QUEUE_PRODUCERS; t++) {
+        jobs[t] = (QueueJob) {queue, list, mutex, items + (size_t) t * n, n};
+        if (pthread_create(&threads[t], NULL, produce, &jobs[t])) {
+            fprintf(stderr, "Thread creation error\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    for (long long received = 0; received < (long long) QUEUE_PRODUCERS * n;) {
+        int* item = queue != NULL ? queue_pop_front(queue) : locked_pop_front(list, mutex);
+        if (item == NULL) {
+            sched_yield();
+            continue;
+        }
+        sum += *item;
+        received++;
+    }
+    for (int t = 0; t < QUEUE_PRODUCERS; t++)
+        pthread_join(threads[t], NULL);
+    double elapsed = wall_seconds() - start;
+    for (long long i = 0; i < (long long) QUEUE_PRODUCERS * n; i++)
+        expected += items[i];
+    if (sum != expected) printf("queue lost elements: sum %lld, expected %lld\n", sum, expected);
+    return elapsed;
+}
+
+// QueueList against List behind a mutex, as a work queue of n items per producer
+void benchmark_queue(int n) {
+    int* items = safe_malloc((size_t) QUEUE_PRODUCERS * n * sizeof(int));
+    for (long long i = 0; i < (long long) QUEUE_PRODUCERS * n; i++)
+        items[i] = (int) (i % 1000);
+    QueueList queue;
+    List list;
+    pthread_mutex_t mutex;
+    init_queue(&queue, NULL);
+    init_list(&list, dump_int, NULL, NULL, NULL);
+    pthread_mutex_init(&mutex, NULL);
+    double queue_time = run_queue(&queue, NULL, NULL, items, n);
+    double list_time = run_queue(NULL, &list, &mutex, items, n);
+    printf("%d producers x %d items: QueueList %.3f s, List + mutex %.3f s\n",
+           QUEUE_PRODUCERS, n, queue_time, list_time);
+    pthread_mutex_destroy(&mutex);
+    free_queue(&queue);
+    free_list(&list);
+    free(items);
+}
+
 int main(void) {
     int to_do, n;
     List list;
+    UnrolledList unrolled;
+    PoolList pool;
+    FrequencyIndex counts;
 
     scanf("%d", &to_do);
     switch (to_do) {
         case 1: // test integer list
             scanf("%d", &n);
             init_list(&list, dump_int, free_int, cmp_int, NULL);
-            list_test(&list, n);
+            list_test(&list, &list_ops, n);
             dump_list(&list);
             free_list(&list);
             break;
         case 2: // read words from text, insert into list, and print
-            init_list(&list, dump_word, free_word, NULL, NULL);
-            stream_to_list(&list, stdin, NULL);
+            init_intrusive_list(&list, dump_word, free_word, NULL, NULL);
+            stream_to_list(&list, stdin, NULL, NULL, NULL);
             dump_list(&list);
             free_list(&list);
             break;
         case 3: // read words, insert into list alphabetically, print words encountered n times
             scanf("%d", &n);
-            init_list(&list, dump_word_lowercase, free_word, NULL, modify_word);
-            stream_to_list(&list, stdin, cmp_word_alphabet);
-            list.compare_data = cmp_word_counter;
-            DataWord data = {NULL, n};
-            dump_list_if(&list, &data);
+            init_intrusive_list(&list, dump_word_lowercase, free_word, NULL, modify_word);
+            init_frequency_index(&counts);
+            stream_to_list(&list, stdin, cmp_word_alphabet, hash_word_folded, &counts);
+            dump_count_equal(&counts, n, dump_word_lowercase, cmp_word_alphabet);
+            free_list(&list);
+            free_frequency_index(&counts);
+            break;
+        case 4: // insert_in_order vs sort_list on n random words
+            scanf("%d", &n);
+            benchmark_sort(n);
+            break;
+        case 5: // read words, print the n most frequent ones
+            scanf("%d", &n);
+            init_intrusive_list(&list, dump_word_lowercase, free_word, NULL, modify_word);
+            init_frequency_index(&counts);
+            stream_to_list(&list, stdin, cmp_word_alphabet, hash_word_folded, &counts);
+            dump_most_frequent(&counts, n, dump_word_lowercase);
             free_list(&list);
+            free_frequency_index(&counts);
+            break;
+        case 6: // lock-free queue vs mutex-wrapped List with n items per producer
+            scanf("%d", &n);
+            benchmark_queue(n);
+            break;
+        case 7: // test integer unrolled list
+            scanf("%d", &n);
+            init_unrolled(&unrolled, dump_int, free_int, cmp_int, NULL);
+            list_test(&unrolled, &unrolled_ops, n);
+            dump_unrolled(&unrolled);
+            free_unrolled(&unrolled);
+            break;
+        case 8: // test integer pool list
+            scanf("%d", &n);
+            init_pool_list(&pool, dump_int, free_int, cmp_int, NULL);
+            list_test(&pool, &pool_ops, n);
+            dump_pool_list(&pool);
+            free_pool_list(&pool);
             break;
         default:
             printf("NOTHING TO DO FOR %d\n", to_do);
@@ -1,40 +1,66 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdbool.h>
 
-// list node
+#define NODE_CAPACITY 54 // values per node: 256-byte, cache-aligned nodes
+#define MAX_DIGITS 10 // digits of INT_MIN and INT_MAX
+#define FINGER_REACH (4 * NODE_CAPACITY) // farther positions go through the size index
+
+// list node: a chunk of one array. An array longer than NODE_CAPACITY spans
+// several consecutive nodes, the first of which has group_start set
 typedef struct Node {
-    int* data;
-    size_t array_size;
-    struct Node* next;
+    _Alignas(64) struct Node* next;
     struct Node* prev;
+    size_t slot; // position in the SizeIndex
+    size_t array_size;
+    bool group_start;
+    int data[NODE_CAPACITY];
 } Node;
 
+// Fenwick tree over the node sizes: prefix sums of array_size in list order
+typedef struct SizeIndex {
+    Node** nodes; // nodes[1 .. count] in list order, NULL for a removed node
+    size_t* tree;
+    size_t count;
+    size_t capacity;
+    bool stale; // a node was inserted in the middle, rebuild before use
+} SizeIndex;
+
 // doubly linked list
 typedef struct List {
     Node* head;
     Node* tail;
+    SizeIndex index;
+    // first node of the array of every digit count, for put_in_order();
+    // only valid while the arrays are ordered by digit count
+    Node* directory[MAX_DIGITS + 1];
+    bool directory_valid;
+    Node* finger; // node of the last located element, NULL if unknown
+    size_t finger_offset; // elements before finger
 } List;
 
+// query of a batch: position in the list and its number in the batch
+typedef struct Query {
+    size_t position;
+    size_t order;
+} Query;
+
+// node of an order-statistics treap kept in an array; index 0 means none
+typedef struct TreapNode {
+    size_t key;
+    size_t size; // nodes in the subtree
+    size_t left;
+    size_t right;
+    unsigned priority;
+} TreapNode;
+
 // iterator
 typedef struct iterator {
     struct Node* node_ptr;
     size_t position;
 } iterator;
 
-// forward initialization
-iterator begin(Node* head) {
-    iterator it = {head, 0};
-    return it;
-}
-
-// backward initialization;
-// points to the element following the last one
-iterator end(Node* tail) {
-    iterator it = {tail, tail->array_size};
-    return it;
-}
-
 void* safe_malloc(size_t size) {
     void* ptr = malloc(size);
     if (ptr) return ptr;
@@ -48,129 +74,579 @@ void* safe_realloc(void* old_ptr, size_t size) {
     exit(EXIT_FAILURE);
 }
 
-Node* create_node(int* data, size_t array_size, Node* next, Node* prev) {
-    Node* node = safe_malloc(sizeof(Node));
-    node->data = data;
-    node->array_size = array_size;
+// empty node starting a new array
+Node* create_node(Node* next, Node* prev) {
+    Node* node = aligned_alloc(_Alignof(Node), sizeof(Node));
+    if (node == NULL) exit(EXIT_FAILURE);
     node->next = next;
     node->prev = prev;
+    node->slot = 0;
+    node->array_size = 0;
+    node->group_start = true;
     return node;
 }
 
+// link node in front of next
+void link_before(Node* next, Node* node) {
+    node->next = next;
+    node->prev = next->prev;
+    next->prev->next = node;
+    next->prev = node;
+}
+
+// true if node is the last chunk of its array
+bool group_end(const List* list, const Node* node) {
+    return node->next == list->tail || node->next->group_start;
+}
+
 // initialize list
 // creates the front and back sentinels
 void init(List* list) {
-    list->head = create_node(NULL, 0, NULL, NULL);
-    list->tail = create_node(NULL, 0, NULL, list->head);
+    list->head = create_node(NULL, NULL);
+    list->tail = create_node(NULL, list->head);
     list->head->next = list->tail;
+    list->index.nodes = NULL;
+    list->index.tree = NULL;
+    list->index.count = 0;
+    list->index.capacity = 0;
+    list->index.stale = false;
+    for (int d = 0; d <= MAX_DIGITS; d++)
+        list->directory[d] = NULL;
+    list->directory_valid = true;
+    list->finger = NULL;
+    list->finger_offset = 0;
 }
 
-// to implement ...
+// --- size index: O(log nodes) positional access
 
-// append node to the list
-void push_back(List* list, int* data, size_t array_size) {
-    Node* new = create_node(data, array_size, list->tail, list->tail->prev);
-    list->tail->prev->next = new;
-    list->tail->prev = new;
+size_t lowest_bit(size_t i) {
+    return i & (~i + 1);
+}
+
+// add delta (wrapping: -k subtracts k) to the size of node in slot
+void index_add(SizeIndex* index, size_t slot, size_t delta) {
+    if (index->stale) return;
+    for (; slot <= index->count; slot += lowest_bit(slot))
+        index->tree[slot] += delta;
 }
 
-// set iterator to move n elements forward from its current position
-void skip_forward(iterator* itr, size_t n) {
-    size_t remaining = n;
-    while (remaining > itr->node_ptr->array_size) {
-        remaining -= itr->node_ptr->array_size;
-        itr->node_ptr = itr->node_ptr->next;
+// append node as the last slot in O(log nodes)
+void index_append(SizeIndex* index, Node* node) {
+    if (index->stale) return;
+    if (index->count + 1 >= index->capacity) {
+        index->capacity = index->capacity == 0 ? 16 : 2 * index->capacity;
+        index->nodes = safe_realloc(index->nodes, index->capacity * sizeof(Node*));
+        index->tree = safe_realloc(index->tree, index->capacity * sizeof(size_t));
     }
-    itr->position = remaining;
+    size_t slot = ++index->count;
+    size_t sum = node->array_size;
+    // tree[slot] covers (slot - lowest_bit(slot), slot]: add the subtrees below it
+    for (size_t child = slot - 1; child > slot - lowest_bit(slot); child -= lowest_bit(child))
+        sum += index->tree[child];
+    index->tree[slot] = sum;
+    index->nodes[slot] = node;
+    node->slot = slot;
 }
 
-// forward iteration - get n-th element in the list
-int get_forward(List* list, size_t n) {
-    iterator itr = begin(list->head);
-    skip_forward(&itr, n);
-    return itr.node_ptr->data[itr.position - 1];
+// renumber the nodes in list order and rebuild the tree in O(nodes)
+void rebuild_index(List* list) {
+    SizeIndex* index = &list->index;
+    index->count = 0;
+    for (Node* node = list->head->next; node != list->tail; node = node->next)
+        index->count++;
+    if (index->count + 1 > index->capacity) {
+        index->capacity = index->count + 1;
+        index->nodes = safe_realloc(index->nodes, index->capacity * sizeof(Node*));
+        index->tree = safe_realloc(index->tree, index->capacity * sizeof(size_t));
+    }
+    size_t slot = 0;
+    for (Node* node = list->head->next; node != list->tail; node = node->next) {
+        node->slot = ++slot;
+        index->nodes[slot] = node;
+        index->tree[slot] = node->array_size;
+    }
+    for (slot = 1; slot <= index->count; slot++) {
+        size_t parent = slot + lowest_bit(slot);
+        if (parent <= index->count) index->tree[parent] += index->tree[slot];
+    }
+    index->stale = false;
+}
+
+// iterator at the n-th element (counted from 1): walked from the finger when
+// n is within FINGER_REACH of it, otherwise found in O(log nodes)
+iterator locate(List* list, size_t n) {
+    Node* node = list->finger;
+    size_t offset = list->finger_offset;
+    if (node != NULL && n + FINGER_REACH > offset && n <= offset + node->array_size + FINGER_REACH) {
+        while (n > offset + node->array_size) {
+            offset += node->array_size;
+            node = node->next;
+        }
+        while (n <= offset) {
+            node = node->prev;
+            offset -= node->array_size;
+        }
+    } else {
+        SizeIndex* index = &list->index;
+        if (index->stale) rebuild_index(list);
+        size_t slot = 0, step = 1;
+        offset = 0;
+        while (2 * step <= index->count) step *= 2;
+        for (; step > 0; step /= 2)
+            if (slot + step <= index->count && offset + index->tree[slot + step] < n) {
+                slot += step;
+                offset += index->tree[slot];
+            }
+        node = index->nodes[slot + 1];
+    }
+    list->finger = node;
+    list->finger_offset = offset;
+    iterator itr = {node, n - offset};
+    return itr;
+}
+
+// number of elements in the list
+size_t total_size(List* list) {
+    SizeIndex* index = &list->index;
+    if (index->stale) rebuild_index(list);
+    size_t total = 0;
+    for (size_t slot = index->count; slot > 0; slot -= lowest_bit(slot))
+        total += index->tree[slot];
+    return total;
+}
+
+void free_index(SizeIndex* index) {
+    free(index->nodes);
+    free(index->tree);
+    index->nodes = NULL;
+    index->tree = NULL;
+    index->count = 0;
+    index->capacity = 0;
 }
 
-// set iterator to move n elements backward from its current position
-void skip_backward(iterator* itr, size_t n) {
-    size_t remaining = n;
-    while (remaining > itr->node_ptr->array_size) {
-        remaining -= itr->node_ptr->array_size;
-        itr->node_ptr = itr->node_ptr->prev;
+// to implement ...
+
+// append a copy of array to the list, in evenly filled nodes;
+// returns the first of them
+Node* append_array(List* list, const int* data, size_t array_size) {
+    Node* first = NULL;
+    size_t nodes = (array_size + NODE_CAPACITY - 1) / NODE_CAPACITY;
+    if (nodes == 0) nodes = 1;
+    size_t done = 0;
+    for (size_t i = 0; i < nodes; i++) {
+        Node* new = create_node(NULL, NULL);
+        new->group_start = i == 0;
+        new->array_size = (array_size - done) / (nodes - i);
+        memcpy(new->data, data + done, sizeof(int) * new->array_size);
+        done += new->array_size;
+        link_before(list->tail, new);
+        index_append(&list->index, new);
+        if (first == NULL) first = new;
     }
-    itr->position = itr->node_ptr->array_size - remaining + 1;
+    return first;
+}
+
+// append node to the list; data is copied and freed
+void push_back(List* list, int* data, size_t array_size) {
+    append_array(list, data, array_size);
+    list->directory_valid = false;
+    free(data);
+}
+
+// forward iteration - get n-th element in the list
+int get_forward(List* list, size_t n) {
+    iterator itr = locate(list, n);
+    return itr.node_ptr->data[itr.position - 1];
 }
 
 // backward iteration - get n-th element from the end of the list
 int get_backward(List* list, size_t n) {
-    iterator itr = end(list->tail);
-    skip_backward(&itr, n);
+    iterator itr = locate(list, total_size(list) - n + 1);
     return itr.node_ptr->data[itr.position - 1];
 }
 
-void remove_node(Node* node_ptr) {
+// unlink and free an empty node; its array continues in the next node if any
+void remove_node(List* list, Node* node_ptr) {
+    bool continues = !group_end(list, node_ptr);
+    if (node_ptr->group_start && continues)
+        node_ptr->next->group_start = true;
+    if (!list->index.stale) list->index.nodes[node_ptr->slot] = NULL;
+    if (list->finger == node_ptr) list->finger = NULL;
+    for (int d = 1; d <= MAX_DIGITS; d++)
+        if (list->directory[d] == node_ptr)
+            list->directory[d] = continues ? node_ptr->next : NULL;
     node_ptr->next->prev = node_ptr->prev;
     node_ptr->prev->next = node_ptr->next;
-    free(node_ptr->data);
     free(node_ptr);
 }
 
-// remove n-th element; if array empty remove node
-void remove_at(List* list, size_t n) {
-    iterator itr = begin(list->head);
-    skip_forward(&itr, n);
-    if (itr.node_ptr->array_size == 1) {
-        remove_node(itr.node_ptr);
+// move count values from the front of second to the back of first or,
+// when count is negative, from the back of first to the front of second
+void shift_values(List* list, Node* first, Node* second, long count) {
+    if (list->finger == second) list->finger = NULL; // values before it change
+    if (count > 0) {
+        size_t moved = (size_t) count;
+        memcpy(first->data + first->array_size, second->data, sizeof(int) * moved);
+        memmove(second->data, second->data + moved, sizeof(int) * (second->array_size - moved));
+        first->array_size += moved;
+        second->array_size -= moved;
+        index_add(&list->index, first->slot, moved);
+        index_add(&list->index, second->slot, -moved);
     } else {
-        memmove(&itr.node_ptr->data[itr.position - 1], &itr.node_ptr->data[itr.position],
-                sizeof(int) * (itr.node_ptr->array_size - itr.position));
-        itr.node_ptr->array_size -= 1;
+        size_t moved = (size_t) -count;
+        memmove(second->data + moved, second->data, sizeof(int) * second->array_size);
+        memcpy(second->data, first->data + first->array_size - moved, sizeof(int) * moved);
+        first->array_size -= moved;
+        second->array_size += moved;
+        index_add(&list->index, first->slot, -moved);
+        index_add(&list->index, second->slot, moved);
+    }
+}
+
+// first and the next node of the same array: merge them if the values fit
+// in one node, otherwise split the values evenly between them
+void merge_nodes(List* list, Node* first, Node* second) {
+    size_t total = first->array_size + second->array_size;
+    if (total <= NODE_CAPACITY) {
+        shift_values(list, first, second, (long) second->array_size);
+        remove_node(list, second);
+    } else shift_values(list, first, second, (long) (total / 2) - (long) first->array_size);
+}
+
+// remove n-th element; if array empty remove node,
+// a node less than half full is merged with a neighbour of the same array
+void remove_at(List* list, size_t n) {
+    iterator itr = locate(list, n);
+    Node* node = itr.node_ptr;
+    memmove(&node->data[itr.position - 1], &node->data[itr.position],
+            sizeof(int) * (node->array_size - itr.position));
+    node->array_size -= 1;
+    index_add(&list->index, node->slot, (size_t) -1);
+    if (node->array_size == 0) remove_node(list, node);
+    else if (node->array_size < NODE_CAPACITY / 2) {
+        if (!group_end(list, node)) merge_nodes(list, node, node->next);
+        else if (!node->group_start) merge_nodes(list, node->prev, node);
     }
 }
 
 // return the number of digits of number n
+// (no loop or division: one comparison per power of 10)
 size_t digits(int n) {
-    if (n == 0) return 1;
-    size_t result = 0;
-    while (n != 0) {
-        n /= 10;
-        result += 1;
+    unsigned sign = 0u - ((unsigned) n >> 31);
+    unsigned magnitude = ((unsigned) n ^ sign) - sign;
+    return 1 + (magnitude >= 10u) + (magnitude >= 100u) + (magnitude >= 1000u) +
+           (magnitude >= 10000u) + (magnitude >= 100000u) + (magnitude >= 1000000u) +
+           (magnitude >= 10000000u) + (magnitude >= 100000000u) + (magnitude >= 1000000000u);
+}
+
+// insert a one-element array before ptr
+void insert_new(List* list, Node* ptr, int value) {
+    Node* new = create_node(NULL, NULL);
+    new->data[0] = value;
+    new->array_size = 1;
+    link_before(ptr, new);
+    if (ptr == list->tail) index_append(&list->index, new);
+    else list->index.stale = true;
+}
+
+// insert value at idx of node; a full node is split in two halves first
+void insert_at(List* list, Node* node, size_t idx, int value) {
+    if (node->array_size == NODE_CAPACITY) {
+        Node* half = create_node(NULL, NULL);
+        half->group_start = false;
+        link_before(node->next, half);
+        list->index.stale = true;
+        shift_values(list, node, half, -(long) (NODE_CAPACITY / 2));
+        if (idx > node->array_size) {
+            idx -= node->array_size;
+            node = half;
+        }
     }
-    return result;
+    memmove(&node->data[idx + 1], &node->data[idx], sizeof(int) * (node->array_size - idx));
+    node->data[idx] = value;
+    node->array_size += 1;
+    index_add(&list->index, node->slot, 1);
 }
 
-void insert_new(Node* ptr, int value) {
-    int* array = safe_malloc(sizeof(int));
-    *array = value;
-    Node* new = create_node(array, 1, ptr, ptr->prev);
-    ptr->prev->next = new;
-    ptr->prev = new;
+// node of the array first .. last where value belongs: the first one whose
+// last value is not less than value, or last. The nodes of an array hold
+// consecutive slots of the size index, so they are binary searched by slot
+// in O(log k); slots of removed nodes are skipped. A stale index (after a
+// node split) is rebuilt first
+Node* find_node(List* list, Node* first, Node* last, int value) {
+    SizeIndex* index = &list->index;
+    if (index->stale) rebuild_index(list);
+    Node* found = last;
+    size_t low = first->slot, high = last->slot; // search the slots low .. high - 1
+    while (low < high) {
+        size_t middle = low + (high - low) / 2, slot = middle;
+        while (slot < high && index->nodes[slot] == NULL) slot++;
+        if (slot == high) high = middle;
+        else if (index->nodes[slot]->data[index->nodes[slot]->array_size - 1] < value) low = slot + 1;
+        else {
+            found = index->nodes[slot];
+            high = middle;
+        }
+    }
+    return found;
 }
 
 // inserts 'value' to the node with the same digits' count
 // otherwise insert new node
 void put_in_order(List* list, int value) {
+    list->finger = NULL; // the value may go before it
     size_t val_digits = digits(value);
-    Node* ptr = list->head->next;
-    if (ptr == list->tail) {
-        insert_new(ptr, value);
+    Node* ptr;
+    if (list->directory_valid) {
+        Node* next = list->tail; // first node of the next array
+        for (size_t d = val_digits + 1; d <= MAX_DIGITS && next == list->tail; d++)
+            if (list->directory[d] != NULL) next = list->directory[d];
+        ptr = list->directory[val_digits];
+        if (ptr == NULL) {
+            insert_new(list, next, value);
+            list->directory[val_digits] = next->prev;
+            return;
+        }
+        ptr = find_node(list, ptr, next->prev, value);
+    } else {
+        ptr = list->head->next;
+        while (ptr != list->tail && digits(ptr->data[0]) < val_digits)
+            ptr = ptr->next;
+        if (ptr == list->tail || digits(ptr->data[0]) != val_digits) {
+            insert_new(list, ptr, value);
+            return;
+        }
+        while (!group_end(list, ptr) && ptr->data[ptr->array_size - 1] < value)
+            ptr = ptr->next;
+    }
+    // binary search for the first value not less than 'value'
+    size_t low = 0, high = ptr->array_size;
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        if (ptr->data[middle] < value) low = middle + 1;
+        else high = middle;
+    }
+    insert_at(list, ptr, low, value);
+}
+
+// --- batches: all queries answered in one sweep over the nodes
+
+int cmp_query(const void* a, const void* b) {
+    size_t first = ((const Query*) a)->position, second = ((const Query*) b)->position;
+    return (first > second) - (first < second);
+}
+
+int cmp_position_descending(const void* a, const void* b) {
+    size_t first = *(const size_t*) a, second = *(const size_t*) b;
+    return (first < second) - (first > second);
+}
+
+// results[i] = get_forward(list, positions[i]) for i < q, in O(q log q + nodes)
+void get_forward_batch(List* list, const size_t positions[], int results[], size_t q) {
+    Query* queries = safe_malloc(q * sizeof(Query));
+    for (size_t i = 0; i < q; i++)
+        queries[i] = (Query) {positions[i], i};
+    qsort(queries, q, sizeof(Query), cmp_query);
+    Node* node = list->head->next;
+    size_t offset = 0; // elements before node
+    for (size_t i = 0; i < q; i++) {
+        while (offset + node->array_size < queries[i].position) {
+            offset += node->array_size;
+            node = node->next;
+        }
+        results[queries[i].order] = node->data[queries[i].position - offset - 1];
+    }
+    free(queries);
+}
+
+// results[i] = get_backward(list, positions[i]) for i < q
+void get_backward_batch(List* list, const size_t positions[], int results[], size_t q) {
+    size_t total = total_size(list);
+    size_t* forward = safe_malloc(q * sizeof(size_t));
+    for (size_t i = 0; i < q; i++)
+        forward[i] = total - positions[i] + 1;
+    get_forward_batch(list, forward, results, q);
+    free(forward);
+}
+
+void treap_update(TreapNode treap[], size_t x) {
+    treap[x].size = treap[treap[x].left].size + treap[treap[x].right].size + 1;
+}
+
+// split subtree x into the keys less than key (*less) and the rest (*rest)
+void treap_split(TreapNode treap[], size_t x, size_t key, size_t* less, size_t* rest) {
+    if (x == 0) {
+        *less = *rest = 0;
         return;
     }
-    while (ptr != list->tail && digits(ptr->data[0]) < val_digits)
-        ptr = ptr->next;
-    if (ptr != list->tail && digits(ptr->data[0]) == val_digits) {
-        ptr->data = safe_realloc(ptr->data, sizeof(int) * (ptr->array_size + 1));
-        int idx = 0;
-        while (idx < ptr->array_size && ptr->data[idx] < value)
-            idx++;
-        if (idx == ptr->array_size) ptr->data[idx] = value;
-        else {
-            memmove(&ptr->data[idx + 1], &ptr->data[idx], sizeof(int) * (ptr->array_size - idx));
-            ptr->data[idx] = value;
+    if (treap[x].key < key) {
+        treap_split(treap, treap[x].right, key, &treap[x].right, rest);
+        *less = x;
+    } else {
+        treap_split(treap, treap[x].left, key, less, &treap[x].left);
+        *rest = x;
+    }
+    treap_update(treap, x);
+}
+
+// join subtrees a and b, all keys of a less than those of b
+size_t treap_merge(TreapNode treap[], size_t a, size_t b) {
+    if (a == 0) return b;
+    if (b == 0) return a;
+    if (treap[a].priority > treap[b].priority) {
+        treap[a].right = treap_merge(treap, treap[a].right, b);
+        treap_update(treap, a);
+        return a;
+    }
+    treap[b].left = treap_merge(treap, a, treap[b].left);
+    treap_update(treap, b);
+    return b;
+}
+
+// original[i]: position in the list before the batch of the element removed
+// by remove_at(list, positions[i]) after the removals 0 .. i - 1.
+// With the removed original positions r(1) < r(2) < ... kept in a treap,
+// r(t) - t (kept elements before r(t)) does not decrease, so one descent
+// finds k, the number of removed positions before the new one:
+// original[i] = positions[i] + k. O(q log q), independent of the list length
+void map_to_original(const size_t positions[], size_t original[], size_t q) {
+    TreapNode* treap = safe_malloc((q + 1) * sizeof(TreapNode));
+    treap[0] = (TreapNode) {0, 0, 0, 0, 0};
+    size_t root = 0;
+    unsigned random = 2463534242u;
+    for (size_t i = 0; i < q; i++) {
+        size_t x = root, before = 0;
+        while (x != 0) {
+            size_t rank = before + treap[treap[x].left].size + 1;
+            if (treap[x].key - rank < positions[i]) {
+                before = rank;
+                x = treap[x].right;
+            } else x = treap[x].left;
         }
-        ptr->array_size += 1;
-    } else insert_new(ptr, value);
-    printf("");
+        original[i] = positions[i] + before;
+        random ^= random << 13; // xorshift
+        random ^= random >> 17;
+        random ^= random << 5;
+        treap[i + 1] = (TreapNode) {original[i], 1, 0, 0, random};
+        size_t less, rest;
+        treap_split(treap, root, original[i], &less, &rest);
+        root = treap_merge(treap, treap_merge(treap, less, i + 1), rest);
+    }
+    free(treap);
+}
+
+// remove_at(list, positions[i]) for i = 0 .. q - 1, where every position
+// refers to the list left by the previous removals. The positions are first
+// mapped to the original list, then all removed in one backward sweep,
+// each node compacted once
+void remove_batch(List* list, const size_t positions[], size_t q) {
+    size_t total = total_size(list);
+    size_t* original = safe_malloc((q + 1) * sizeof(size_t));
+    map_to_original(positions, original, q);
+    qsort(original, q, sizeof(size_t), cmp_position_descending);
+    original[q] = 0; // sentinel below every position
+
+    list->index.stale = true; // nodes change all over: rebuild on next use
+    list->finger = NULL;
+    size_t offset = total, i = 0; // offset: elements up to and including node
+    Node* previous;
+    for (Node* node = list->tail->prev; node != list->head && i < q; node = previous) {
+        previous = node->prev;
+        size_t first = offset - node->array_size; // elements before node
+        size_t end = i;
+        while (original[end] > first) end++; // original[i .. end) lie in node
+        if (end > i) {
+            size_t kept = original[end - 1] - first - 1; // values before the lowest removal stay
+            size_t next = end; // original[next - 1]: lowest removal not passed yet
+            for (size_t k = kept; k < node->array_size; k++) {
+                if (next > i && original[next - 1] == first + k + 1) {
+                    next--;
+                    continue;
+                }
+                node->data[kept++] = node->data[k];
+            }
+            node->array_size = kept;
+            i = end;
+            if (kept == 0) { // emptied by the batch; an array given empty stays
+                offset = first;
+                remove_node(list, node);
+                continue;
+            }
+        }
+        offset = first;
+        if (!group_end(list, node) && (node->array_size < NODE_CAPACITY / 2 ||
+                                            node->next->array_size < NODE_CAPACITY / 2))
+            merge_nodes(list, node, node->next);
+    }
+    free(original);
+}
+
+// --- bulk build
+
+#define RADIX_BITS 11 // three passes over 32-bit keys, 2048 counters each
+
+// sort values in place: LSD radix sort (sign bit flipped), then a stable
+// counting sort by digit count, which leaves every run of equal digit count
+// in ascending order. runs[d] is set to the number of values with d digits.
+// All the histograms are taken in a single read of the values
+void sort_by_digits(int values[], size_t n, size_t runs[MAX_DIGITS + 1]) {
+    size_t count[3][1 << RADIX_BITS] = {{0}};
+    const unsigned mask = (1u << RADIX_BITS) - 1;
+    unsigned* keys = safe_malloc(n * sizeof(unsigned));
+    unsigned* buffer = safe_malloc(n * sizeof(unsigned));
+    for (int d = 0; d <= MAX_DIGITS; d++)
+        runs[d] = 0;
+    for (size_t i = 0; i < n; i++) {
+        unsigned key = (unsigned) values[i] ^ 0x80000000u;
+        keys[i] = key;
+        count[0][key & mask]++;
+        count[1][(key >> RADIX_BITS) & mask]++;
+        count[2][key >> 2 * RADIX_BITS]++;
+        runs[digits(values[i])]++;
+    }
+    for (int pass = 0; pass < 3; pass++) {
+        size_t sum = 0;
+        for (unsigned b = 0; b <= mask; b++) {
+            size_t here = count[pass][b];
+            count[pass][b] = sum;
+            sum += here;
+        }
+        int shift = pass * RADIX_BITS;
+        for (size_t i = 0; i < n; i++)
+            buffer[count[pass][(keys[i] >> shift) & mask]++] = keys[i];
+        unsigned* tmp = keys;
+        keys = buffer;
+        buffer = tmp;
+    }
+    size_t start[MAX_DIGITS + 1] = {0}; // first slot of each digit count
+    for (int d = 2; d <= MAX_DIGITS; d++)
+        start[d] = start[d - 1] + runs[d - 1];
+    for (size_t i = 0; i < n; i++) {
+        int value = (int) (keys[i] ^ 0x80000000u);
+        values[start[digits(value)]++] = value;
+    }
+    free(keys);
+    free(buffer);
+}
+
+// the list put_in_order() makes from values, built at once: values are
+// sorted by sort_by_digits() and every digit count becomes one array.
+// A list that is not empty gets the values one by one
+void build_in_order(List* list, int values[], size_t n) {
+    if (list->head->next != list->tail) {
+        for (size_t i = 0; i < n; i++)
+            put_in_order(list, values[i]);
+        return;
+    }
+    size_t runs[MAX_DIGITS + 1];
+    sort_by_digits(values, n, runs);
+    size_t start = 0;
+    for (int d = 1; d <= MAX_DIGITS; d++) {
+        if (runs[d] == 0) continue;
+        list->directory[d] = append_array(list, values + start, runs[d]);
+        start += runs[d];
+    }
+    list->directory_valid = true;
 }
 
 // -------------------------------------------------------------
@@ -179,11 +655,11 @@ void put_in_order(List* list, int value) {
 // print list
 void dumpList(const List* list) {
     for (Node* node = list->head->next; node != list->tail; node = node->next) {
-        printf("-> ");
+        if (node->group_start) printf("-> ");
         for (int k = 0; k < node->array_size; k++) {
             printf("%d ", node->data[k]);
         }
-        printf("\n");
+        if (group_end(list, node)) printf("\n");
     }
 }
 
@@ -192,9 +668,11 @@ void freeList(List* list) {
     Node* to_delete = list->head->next, * next;
     while (to_delete != list->tail) {
         next = to_delete->next;
-        remove_node(to_delete);
+        free(to_delete);
         to_delete = next;
     }
+    free_index(&list->index);
+    list->finger = NULL;
 }
 
 // read int vector
@@ -204,6 +682,13 @@ void read_vector(int tab[], size_t n) {
     }
 }
 
+// read query positions
+void read_positions(size_t tab[], size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        scanf("%zu", tab + i);
+    }
+}
+
 // initialize the list and push data
 void read_list(List* list) {
     int n;
@@ -218,8 +703,11 @@ void read_list(List* list) {
 }
 
 int main() {
-    int to_do, value;
-    size_t size, m;
+    int to_do;
+    size_t size;
+    size_t* positions;
+    int* results;
+    int* values;
     List list;
     init(&list);
 
@@ -230,38 +718,52 @@ int main() {
             dumpList(&list);
             break;
         case 2:
-            read_list(&list);
-            scanf("%zu", &size);
-            for (int i = 0; i < size; i++) {
-                scanf("%zu", &m);
-                printf("%d ", get_forward(&list, m));
-            }
-            printf("\n");
-            break;
         case 3:
             read_list(&list);
             scanf("%zu", &size);
-            for (int i = 0; i < size; i++) {
-                scanf("%zu", &m);
-                printf("%d ", get_backward(&list, m));
-            }
+            positions = safe_malloc(size * sizeof(size_t));
+            results = safe_malloc(size * sizeof(int));
+            read_positions(positions, size);
+            if (to_do == 2) get_forward_batch(&list, positions, results, size);
+            else get_backward_batch(&list, positions, results, size);
+            for (size_t i = 0; i < size; i++)
+                printf("%d ", results[i]);
             printf("\n");
+            free(positions);
+            free(results);
             break;
         case 4:
             read_list(&list);
             scanf("%zu", &size);
-            for (int i = 0; i < size; i++) {
-                scanf("%zu", &m);
-                remove_at(&list, m);
-            }
+            positions = safe_malloc(size * sizeof(size_t));
+            read_positions(positions, size);
+            remove_batch(&list, positions, size);
+            free(positions);
             dumpList(&list);
             break;
         case 5:
             scanf("%zu", &size);
-            for (int i = 0; i < size; i++) {
-                scanf("%d", &value);
-                put_in_order(&list, value);
-            }
+            values = safe_malloc(size * sizeof(int));
+            read_vector(values, size);
+            build_in_order(&list, values, size);
+            free(values);
+            dumpList(&list);
+            break;
+        case 6: // the queries of cases 2 and 4 one at a time, through the finger
+            read_list(&list);
+            scanf("%zu", &size);
+            positions = safe_malloc(size * sizeof(size_t));
+            read_positions(positions, size);
+            for (size_t i = 0; i < size; i++)
+                printf("%d ", get_forward(&list, positions[i]));
+            printf("\n");
+            free(positions);
+            scanf("%zu", &size);
+            positions = safe_malloc(size * sizeof(size_t));
+            read_positions(positions, size);
+            for (size_t i = 0; i < size; i++)
+                remove_at(&list, positions[i]);
+            free(positions);
             dumpList(&list);
             break;
         default: